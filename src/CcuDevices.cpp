@@ -0,0 +1,177 @@
+/* Copyright 2013-2019 Homegear GmbH */
+
+#include "CcuDevices.h"
+#include "DescriptionCreator.h"
+#include "GD.h"
+
+namespace MyFamily
+{
+
+CcuDevices::CcuDevices(BaseLib::SharedObjects* bl, BaseLib::DeviceDescription::Devices::IDevicesEventSink* eventHandler, int32_t family) : BaseLib::DeviceDescription::Devices(bl, eventHandler, family)
+{
+}
+
+void CcuDevices::setDevices(std::vector<std::shared_ptr<BaseLib::DeviceDescription::HomegearDevice>>& devices, std::unordered_map<uint32_t, BaseLib::PVariable>& sources, bool onDemand)
+{
+    try
+    {
+        std::lock_guard<std::mutex> onDemandGuard(_onDemandMutex);
+        _devices = devices;
+        _sources = sources;
+        _onDemand = onDemand;
+        //Peers keep their current description until they request it again.
+        _onDemandDevices.clear();
+        _lru.clear();
+    }
+    catch(const std::exception& ex)
+    {
+        GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+    }
+}
+
+std::shared_ptr<BaseLib::DeviceDescription::HomegearDevice> CcuDevices::get(uint32_t typeNumber, int32_t firmwareVersion)
+{
+    try
+    {
+        std::lock_guard<std::mutex> onDemandGuard(_onDemandMutex);
+        if(!_onDemand) return find(typeNumber, firmwareVersion, -1);
+
+        auto deviceIterator = _onDemandDevices.find(typeNumber);
+        if(deviceIterator != _onDemandDevices.end())
+        {
+            _lru.splice(_lru.begin(), _lru, deviceIterator->second.second);
+            return deviceIterator->second.first;
+        }
+
+        auto sourceIterator = _sources.find(typeNumber);
+        if(sourceIterator == _sources.end()) return find(typeNumber, firmwareVersion, -1);
+
+        DescriptionCreator descriptionCreator;
+        auto device = descriptionCreator.createDevice(sourceIterator->second);
+        if(!device) return std::shared_ptr<BaseLib::DeviceDescription::HomegearDevice>();
+
+        _lru.push_front(typeNumber);
+        _onDemandDevices.emplace(typeNumber, std::make_pair(device, _lru.begin()));
+        dropUnusedDevices();
+        return device;
+    }
+    catch(const std::exception& ex)
+    {
+        GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+    }
+    return std::shared_ptr<BaseLib::DeviceDescription::HomegearDevice>();
+}
+
+BaseLib::PVariable CcuDevices::getSource(uint32_t typeNumber)
+{
+    try
+    {
+        std::lock_guard<std::mutex> onDemandGuard(_onDemandMutex);
+        auto sourceIterator = _sources.find(typeNumber);
+        if(sourceIterator != _sources.end()) return sourceIterator->second;
+    }
+    catch(const std::exception& ex)
+    {
+        GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+    }
+    return BaseLib::PVariable();
+}
+
+void CcuDevices::setSource(uint32_t typeNumber, const BaseLib::PVariable& source)
+{
+    try
+    {
+        std::lock_guard<std::mutex> onDemandGuard(_onDemandMutex);
+        _sources[typeNumber] = source;
+        if(!_onDemand)
+        {
+            DescriptionCreator descriptionCreator;
+            auto device = descriptionCreator.createDevice(source);
+            if(!device)
+            {
+                GD::out.printError("Error: Could not create description for type number 0x" + BaseLib::HelperFunctions::getHexString(typeNumber) + ".");
+                return;
+            }
+
+            //BaseLib might iterate "_devices" right now, so the list is replaced as a whole instead of modifying it in place.
+            std::vector<std::shared_ptr<BaseLib::DeviceDescription::HomegearDevice>> devices;
+            devices.reserve(_devices.size() + 1);
+            for(auto& oldDevice : _devices)
+            {
+                bool replaced = false;
+                for(auto& supportedDevice : oldDevice->supportedDevices)
+                {
+                    if(supportedDevice->typeNumber == typeNumber)
+                    {
+                        replaced = true;
+                        break;
+                    }
+                }
+                if(!replaced) devices.push_back(oldDevice);
+            }
+            devices.push_back(device);
+            _devices = std::move(devices);
+            return;
+        }
+
+        auto deviceIterator = _onDemandDevices.find(typeNumber);
+        if(deviceIterator != _onDemandDevices.end())
+        {
+            _lru.erase(deviceIterator->second.second);
+            _onDemandDevices.erase(deviceIterator);
+        }
+    }
+    catch(const std::exception& ex)
+    {
+        GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+    }
+}
+
+std::unordered_set<uint64_t> CcuDevices::getAllTypeNumbers()
+{
+    try
+    {
+        auto typeNumbers = getKnownTypeNumbers();
+        std::lock_guard<std::mutex> onDemandGuard(_onDemandMutex);
+        for(auto& source : _sources)
+        {
+            typeNumbers.emplace(source.first);
+        }
+        return typeNumbers;
+    }
+    catch(const std::exception& ex)
+    {
+        GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+    }
+    return std::unordered_set<uint64_t>();
+}
+
+void CcuDevices::dropUnusedDevices()
+{
+    try
+    {
+        size_t unusedDevices = 0;
+        for(auto& device : _onDemandDevices)
+        {
+            if(device.second.first.use_count() == 1) unusedDevices++;
+        }
+        if(unusedDevices <= _maxUnusedDevices) return;
+
+        //Walk from the least recently used description. The description just created is first and always kept.
+        for(auto lruIterator = std::prev(_lru.end()); lruIterator != _lru.begin() && unusedDevices > _maxUnusedDevices;)
+        {
+            auto deviceIterator = _onDemandDevices.find(*lruIterator);
+            auto currentIterator = lruIterator--;
+            if(deviceIterator == _onDemandDevices.end() || deviceIterator->second.first.use_count() > 1) continue;
+            _onDemandDevices.erase(deviceIterator);
+            _lru.erase(currentIterator);
+            unusedDevices--;
+        }
+    }
+    catch(const std::exception& ex)
+    {
+        GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+    }
+}
+
+}
@@ -0,0 +1,84 @@
+/* Copyright 2013-2019 Homegear GmbH */
+
+#ifndef HOMEGEAR_CCU_CCUDEVICES_H
+#define HOMEGEAR_CCU_CCUDEVICES_H
+
+#include <homegear-base/BaseLib.h>
+
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace MyFamily
+{
+
+/**
+ * The RPC device collection of the family. Descriptions are loaded by "DescriptionCache" instead of parsing the whole "desc" directory.
+ * Descriptions with a cached source are only created when they are first requested by "get". They are kept in an LRU list. The least recently used
+ * descriptions are dropped when there are more than "_maxUnusedDevices" descriptions no peer uses.
+ *
+ * Descriptions not created yet are not in "_devices". They are only found through "get" and "getAllTypeNumbers", not through BaseLib's "find" or
+ * the list of supported devices. That's why on-demand creation is only used with the family setting "loadDescriptionsOnDemand". Otherwise all
+ * descriptions are in "_devices" and the sources are only kept to update descriptions.
+ */
+class CcuDevices : public BaseLib::DeviceDescription::Devices
+{
+public:
+    CcuDevices(BaseLib::SharedObjects* bl, BaseLib::DeviceDescription::Devices::IDevicesEventSink* eventHandler, int32_t family);
+    virtual ~CcuDevices() = default;
+
+    /**
+     * Replaces all descriptions.
+     *
+     * @param devices The descriptions to keep loaded at all times.
+     * @param sources The sources of all cached descriptions by type number as returned by "DescriptionCache::load".
+     * @param onDemand When true, descriptions with a source are created on demand. Otherwise "devices" has to contain them already.
+     */
+    void setDevices(std::vector<std::shared_ptr<BaseLib::DeviceDescription::HomegearDevice>>& devices, std::unordered_map<uint32_t, BaseLib::PVariable>& sources, bool onDemand);
+
+    /**
+     * Returns the description for the given type number. Use this instead of "find", which doesn't know descriptions not created yet.
+     *
+     * @return Returns the description or nullptr if no description was found.
+     */
+    std::shared_ptr<BaseLib::DeviceDescription::HomegearDevice> get(uint32_t typeNumber, int32_t firmwareVersion);
+
+    /**
+     * Returns the source of a description created by "DescriptionCreator" or nullptr if the description has no cached source.
+     */
+    BaseLib::PVariable getSource(uint32_t typeNumber);
+
+    /**
+     * Replaces the source of a single description. In on-demand mode the description is created again on the next call to "get". Otherwise it is
+     * created immediately and replaces the old description in "_devices". Peers keep their current description until they request it again.
+     */
+    void setSource(uint32_t typeNumber, const BaseLib::PVariable& source);
+
+    /**
+     * Returns the type numbers of all descriptions including the ones not created yet.
+     */
+    std::unordered_set<uint64_t> getAllTypeNumbers();
+private:
+    const size_t _maxUnusedDevices = 20;
+
+    std::mutex _onDemandMutex;
+    bool _onDemand = false;
+    std::unordered_map<uint32_t, BaseLib::PVariable> _sources;
+
+    /**
+     * The type numbers of all created descriptions. The most recently used one is first.
+     */
+    std::list<uint32_t> _lru;
+    std::unordered_map<uint32_t, std::pair<std::shared_ptr<BaseLib::DeviceDescription::HomegearDevice>, std::list<uint32_t>::iterator>> _onDemandDevices;
+
+    /**
+     * Drops the least recently used descriptions not used by any peer. Descriptions used by peers are pinned, because they are referenced by the
+     * peer anyway. Dropping them would only create a second copy on the next request. Requires "_onDemandMutex" to be locked.
+     */
+    void dropUnusedDevices();
+};
+
+}
+
+#endif
@@ -0,0 +1,372 @@
+/* Copyright 2013-2019 Homegear GmbH
+ *
+ * Homegear is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Homegear is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Homegear.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ */
+
+#include "CcuDiscovery.h"
+#include "GD.h"
+
+#include <algorithm>
+
+#include <arpa/inet.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace MyFamily {
+
+CcuDiscovery::CcuDiscovery(ResultCallback resultCallback) {
+  _resultCallback.swap(resultCallback);
+}
+
+CcuDiscovery::~CcuDiscovery() {
+  stop();
+}
+
+bool CcuDiscovery::start() {
+  try {
+    if (!_stopped) return true;
+
+    {
+      std::lock_guard<std::mutex> searchGuard(_searchMutex);
+      _searchSocket = createSearchSocket();
+      if (!_searchSocket) return false;
+      //Not fatal, we only miss announcements.
+      _announcementSocket = createAnnouncementSocket();
+      _receivingAnnouncements = (bool)_announcementSocket;
+    }
+
+    _epollDescriptor = epoll_create1(EPOLL_CLOEXEC);
+    _eventDescriptor = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (_epollDescriptor == -1 || _eventDescriptor == -1) {
+      GD::out.printError("Error: Could not create epoll or event descriptor: " + std::string(strerror(errno)));
+      stop();
+      return false;
+    }
+
+    struct epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = _eventDescriptor;
+    epoll_ctl(_epollDescriptor, EPOLL_CTL_ADD, _eventDescriptor, &event);
+    event.data.fd = _searchSocket->descriptor;
+    epoll_ctl(_epollDescriptor, EPOLL_CTL_ADD, _searchSocket->descriptor, &event);
+    if (_announcementSocket) {
+      event.data.fd = _announcementSocket->descriptor;
+      epoll_ctl(_epollDescriptor, EPOLL_CTL_ADD, _announcementSocket->descriptor, &event);
+    }
+
+    _stopped = false;
+    GD::bl->threadManager.start(_listenThread, true, &CcuDiscovery::listen, this);
+    return true;
+  }
+  catch (const std::exception &ex) {
+    GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+  }
+  return false;
+}
+
+void CcuDiscovery::stop() {
+  try {
+    _stopped = true;
+    if (_eventDescriptor != -1) wakeUp();
+    GD::bl->threadManager.join(_listenThread);
+
+    {
+      //"search" uses the search socket.
+      std::lock_guard<std::mutex> searchGuard(_searchMutex);
+      if (_searchSocket) GD::bl->fileDescriptorManager.shutdown(_searchSocket);
+      if (_announcementSocket) GD::bl->fileDescriptorManager.shutdown(_announcementSocket);
+      _searchSocket.reset();
+      _announcementSocket.reset();
+      _receivingAnnouncements = false;
+      _searching = false;
+      _finishedCallback = nullptr;
+    }
+
+    if (_epollDescriptor != -1) close(_epollDescriptor);
+    if (_eventDescriptor != -1) close(_eventDescriptor);
+    _epollDescriptor = -1;
+    _eventDescriptor = -1;
+  }
+  catch (const std::exception &ex) {
+    GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+  }
+}
+
+BaseLib::PFileDescriptor CcuDiscovery::createSearchSocket() {
+  try {
+    auto socketDescriptor = GD::bl->fileDescriptorManager.add(socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0));
+    if (socketDescriptor->descriptor == -1) {
+      GD::out.printError("Error: Could not create socket.");
+      return BaseLib::PFileDescriptor();
+    }
+
+    int32_t reuse = 1;
+    if (setsockopt(socketDescriptor->descriptor, SOL_SOCKET, SO_REUSEADDR, (char *)&reuse, sizeof(reuse)) == -1) {
+      GD::out.printWarning("Warning: Could set socket options: " + std::string(strerror(errno)));
+    }
+
+    char loopch = 0;
+    if (setsockopt(socketDescriptor->descriptor, IPPROTO_IP, IP_MULTICAST_LOOP, (char *)&loopch, sizeof(loopch)) == -1) {
+      GD::out.printWarning("Warning: Could set socket options: " + std::string(strerror(errno)));
+    }
+
+    struct in_addr localInterface{};
+    localInterface.s_addr = inet_addr("0.0.0.0");
+    if (setsockopt(socketDescriptor->descriptor, IPPROTO_IP, IP_MULTICAST_IF, (char *)&localInterface, sizeof(localInterface)) == -1) {
+      GD::out.printWarning("Warning: Could set socket options: " + std::string(strerror(errno)));
+    }
+
+    struct sockaddr_in localSock{};
+    localSock.sin_family = AF_INET;
+    localSock.sin_port = 0;
+    localSock.sin_addr.s_addr = inet_addr(_multicastAddress.c_str());
+
+    if (bind(socketDescriptor->descriptor.load(), (struct sockaddr *)&localSock, sizeof(localSock)) == -1) {
+      GD::out.printError("Error: Binding failed: " + std::string(strerror(errno)));
+      GD::bl->fileDescriptorManager.shutdown(socketDescriptor);
+      return BaseLib::PFileDescriptor();
+    }
+
+    return socketDescriptor;
+  }
+  catch (const std::exception &ex) {
+    GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+  }
+  return BaseLib::PFileDescriptor();
+}
+
+BaseLib::PFileDescriptor CcuDiscovery::createAnnouncementSocket() {
+  try {
+    auto socketDescriptor = GD::bl->fileDescriptorManager.add(socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0));
+    if (socketDescriptor->descriptor == -1) return BaseLib::PFileDescriptor();
+
+    int32_t reuse = 1;
+    if (setsockopt(socketDescriptor->descriptor, SOL_SOCKET, SO_REUSEADDR, (char *)&reuse, sizeof(reuse)) == -1) {
+      GD::out.printWarning("Warning: Could set socket options: " + std::string(strerror(errno)));
+    }
+
+    struct sockaddr_in localSock{};
+    localSock.sin_family = AF_INET;
+    localSock.sin_port = htons(_port);
+    localSock.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(socketDescriptor->descriptor.load(), (struct sockaddr *)&localSock, sizeof(localSock)) == -1) {
+      GD::out.printInfo("Info: Could not listen for CCU announcements on port " + std::to_string(_port) + ": " + std::string(strerror(errno)));
+      GD::bl->fileDescriptorManager.shutdown(socketDescriptor);
+      return BaseLib::PFileDescriptor();
+    }
+
+    struct ip_mreq group{};
+    group.imr_multiaddr.s_addr = inet_addr(_multicastAddress.c_str());
+    group.imr_interface.s_addr = htonl(INADDR_ANY);
+    if (setsockopt(socketDescriptor->descriptor, IPPROTO_IP, IP_ADD_MEMBERSHIP, (char *)&group, sizeof(group)) == -1) {
+      GD::out.printInfo("Info: Could not join multicast group for CCU announcements: " + std::string(strerror(errno)));
+      GD::bl->fileDescriptorManager.shutdown(socketDescriptor);
+      return BaseLib::PFileDescriptor();
+    }
+
+    return socketDescriptor;
+  }
+  catch (const std::exception &ex) {
+    GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+  }
+  return BaseLib::PFileDescriptor();
+}
+
+void CcuDiscovery::wakeUp() {
+  uint64_t value = 1;
+  if (write(_eventDescriptor, &value, sizeof(value)) == -1 && errno != EAGAIN) {
+    GD::out.printWarning("Warning: Could not wake up discovery thread: " + std::string(strerror(errno)));
+  }
+}
+
+bool CcuDiscovery::search(const std::set<std::string> &expectedSerialNumbers, uint32_t timeout, uint32_t minimumDuration, FinishedCallback finishedCallback) {
+  try {
+    BaseLib::PFileDescriptor searchSocket;
+    {
+      std::lock_guard<std::mutex> searchGuard(_searchMutex);
+      if (_stopped || !_searchSocket || _searching) return false;
+      searchSocket = _searchSocket;
+      int64_t time = BaseLib::HelperFunctions::getTime();
+      _expectedSerialNumbers = expectedSerialNumbers;
+      _foundSerialNumbers.clear();
+      _searchEndTime = time + timeout;
+      _searchMinimumEndTime = time + minimumDuration;
+      _finishedCallback.swap(finishedCallback);
+      _searching = true;
+    }
+
+    struct sockaddr_in addessInfo{};
+    addessInfo.sin_family = AF_INET;
+    addessInfo.sin_addr.s_addr = inet_addr(_multicastAddress.c_str());
+    addessInfo.sin_port = htons(_port);
+
+    std::vector<uint8_t> broadcastPacket{2, 0xBE, 0x41, 0xD8, 1, 0x65, 0x51, 0x33, 0x2D, 0x2A, 0, 0x2A, 0, 0x49};
+    if (sendto(searchSocket->descriptor, (char *)broadcastPacket.data(), broadcastPacket.size(), 0, (struct sockaddr *)&addessInfo, sizeof(addessInfo)) == -1) {
+      GD::out.printWarning("Warning: Could send SSDP search broadcast packet: " + std::string(strerror(errno)));
+    }
+
+    //Let the thread pick up the new timeout.
+    wakeUp();
+    return true;
+  }
+  catch (const std::exception &ex) {
+    GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+  }
+  return false;
+}
+
+void CcuDiscovery::listen() {
+  const int32_t maxEvents = 4;
+  struct epoll_event events[maxEvents];
+  while (!_stopped) {
+    try {
+      int32_t timeout = 1000;
+      if (_searching) {
+        std::lock_guard<std::mutex> searchGuard(_searchMutex);
+        int64_t time = BaseLib::HelperFunctions::getTime();
+        timeout = (int32_t)std::max((int64_t)0, std::min((int64_t)timeout, _searchEndTime - time));
+      }
+
+      int32_t eventCount = epoll_wait(_epollDescriptor, events, maxEvents, timeout);
+      if (_stopped) break;
+      if (eventCount == -1) {
+        if (errno == EINTR) continue;
+        GD::out.printError("Error: epoll_wait failed in CCU discovery: " + std::string(strerror(errno)));
+        std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+        continue;
+      }
+
+      for (int32_t i = 0; i < eventCount; i++) {
+        if (events[i].data.fd == _eventDescriptor) {
+          uint64_t value = 0;
+          if (read(_eventDescriptor, &value, sizeof(value)) == -1 && errno != EAGAIN) {
+            GD::out.printWarning("Warning: Could not read event descriptor: " + std::string(strerror(errno)));
+          }
+        } else if (_searchSocket && events[i].data.fd == _searchSocket->descriptor) receive(_searchSocket, true);
+        else if (_announcementSocket && events[i].data.fd == _announcementSocket->descriptor) receive(_announcementSocket, false);
+      }
+
+      if (_searching) checkSearch();
+    }
+    catch (const std::exception &ex) {
+      GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+    }
+  }
+}
+
+void CcuDiscovery::receive(const BaseLib::PFileDescriptor &socketDescriptor, bool searchResponse) {
+  try {
+    char buffer[1024];
+    struct sockaddr info{};
+    socklen_t slen = sizeof(info);
+    while (!_stopped) {
+      int32_t bytesReceived = recvfrom(socketDescriptor->descriptor, buffer, sizeof(buffer), 0, &info, &slen);
+      if (bytesReceived == -1) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+          GD::out.printError("Error: Could not read from discovery socket: " + std::string(strerror(errno)));
+          if (!searchResponse) _receivingAnnouncements = false;
+        }
+        return;
+      }
+      if (bytesReceived == 0 || info.sa_family != AF_INET) continue;
+      if (GD::bl->debugLevel >= 5) GD::out.printDebug("Debug: Response received:\n" + std::string(buffer, bytesReceived));
+
+      DiscoveredCcu ccu;
+      if (!parse(buffer, bytesReceived, ccu)) continue;
+
+      struct sockaddr_in *s = (struct sockaddr_in *)&info;
+      char ipStringBuffer[INET6_ADDRSTRLEN];
+      inet_ntop(AF_INET, &s->sin_addr, ipStringBuffer, sizeof(ipStringBuffer));
+      ccu.ipAddress = std::string(ipStringBuffer);
+      ccu.searchResponse = searchResponse;
+      if (ccu.serialNumber.empty() || ccu.ipAddress.empty()) continue;
+
+      if (_searching) {
+        std::lock_guard<std::mutex> searchGuard(_searchMutex);
+        _foundSerialNumbers.emplace(ccu.serialNumber);
+      }
+      if (_resultCallback) _resultCallback(ccu);
+    }
+  }
+  catch (const std::exception &ex) {
+    GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+  }
+}
+
+bool CcuDiscovery::parse(const char *buffer, int32_t size, DiscoveredCcu &ccu) {
+  //Format: 5 bytes header, device type, 0, serial number, 0, 3 bytes, version, 0
+  static const std::vector<uint8_t> expectedResponse{2, 0xBE, 0x41, 0xD8, 1};
+  if (size < 5 || std::vector<uint8_t>(buffer, buffer + 5) != expectedResponse) return false;
+
+  const char *pos = (const char *)memchr(buffer + 5, 0, size - 5);
+  if (!pos) return false;
+  ccu.deviceType = std::string(buffer + 5, pos - (buffer + 5));
+  if (ccu.deviceType != "eQ3-HM-CCU2-App" && ccu.deviceType != "eQ3-HmIP-CCU3-App") {
+    GD::out.printInfo("Info: Ignoring unknown device: " + ccu.deviceType);
+    return false;
+  }
+
+  const char *serialStart = pos + 1;
+  if (serialStart >= buffer + size) return false;
+  pos = (const char *)memchr(serialStart, 0, (buffer + size) - serialStart);
+  if (!pos) return false;
+  std::string serial(serialStart, pos - serialStart);
+  ccu.serialNumber = BaseLib::HelperFunctions::stripNonAlphaNumeric(serial);
+
+  const char *versionStart = serialStart + serial.size() + 4;
+  if (versionStart >= buffer + size) return false;
+  pos = (const char *)memchr(versionStart, 0, (buffer + size) - versionStart);
+  if (!pos) return false;
+  ccu.version = std::string(versionStart, pos - versionStart);
+  return true;
+}
+
+void CcuDiscovery::checkSearch() {
+  try {
+    FinishedCallback finishedCallback;
+    std::set<std::string> foundSerialNumbers;
+    {
+      std::lock_guard<std::mutex> searchGuard(_searchMutex);
+      if (!_searching) return;
+      int64_t time = BaseLib::HelperFunctions::getTime();
+      bool allFound = !_expectedSerialNumbers.empty() && std::includes(_foundSerialNumbers.begin(), _foundSerialNumbers.end(), _expectedSerialNumbers.begin(), _expectedSerialNumbers.end());
+      if (time < _searchEndTime && (!allFound || time < _searchMinimumEndTime)) return;
+
+      finishedCallback.swap(_finishedCallback);
+      foundSerialNumbers.swap(_foundSerialNumbers);
+      _searching = false;
+    }
+
+    if (finishedCallback) finishedCallback(foundSerialNumbers);
+  }
+  catch (const std::exception &ex) {
+    GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+  }
+}
+
+}
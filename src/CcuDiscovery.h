@@ -0,0 +1,123 @@
+/* Copyright 2013-2019 Homegear GmbH
+ *
+ * Homegear is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Homegear is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Homegear.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ */
+
+#ifndef HOMEGEAR_CCU_CCUDISCOVERY_H
+#define HOMEGEAR_CCU_CCUDISCOVERY_H
+
+#include <homegear-base/BaseLib.h>
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+
+namespace MyFamily
+{
+
+/**
+ * Finds CCUs using the eQ-3 discovery protocol. Responses are received by a background thread using epoll. Besides answers to active searches,
+ * unsolicited announcements sent to the discovery multicast group are reported, too.
+ */
+class CcuDiscovery
+{
+public:
+    struct DiscoveredCcu
+    {
+        std::string serialNumber;
+        std::string ipAddress;
+        std::string deviceType;
+        std::string version;
+
+        /**
+         * True when the packet was received on the search socket, false when it was an unsolicited announcement.
+         */
+        bool searchResponse = false;
+    };
+
+    typedef std::function<void(const DiscoveredCcu &ccu)> ResultCallback;
+    typedef std::function<void(const std::set<std::string> &serialNumbers)> FinishedCallback;
+
+    explicit CcuDiscovery(ResultCallback resultCallback);
+    virtual ~CcuDiscovery();
+
+    bool start();
+    void stop();
+
+    /**
+     * Sends a search packet and returns immediately. The result callback is called for every CCU found.
+     *
+     * @param expectedSerialNumbers The serial numbers of all known CCUs. The search finishes early when all of them answered.
+     * @param timeout The maximum duration of the search in milliseconds.
+     * @param minimumDuration The search doesn't finish early before this many milliseconds passed. Use it to give unknown CCUs time to answer.
+     * @param finishedCallback Called with the serial numbers of all CCUs that answered when the search finished. May be nullptr.
+     * @return Returns false when a search is already running or the discovery is not started.
+     */
+    bool search(const std::set<std::string> &expectedSerialNumbers, uint32_t timeout, uint32_t minimumDuration, FinishedCallback finishedCallback);
+    bool searching() { return _searching; }
+
+    /**
+     * Returns false when the announcements of CCUs can't be received, e. g. because another process uses the discovery port. Changes of the CCUs'
+     * IP addresses are then only noticed by searching.
+     */
+    bool receivingAnnouncements() { return _receivingAnnouncements; }
+private:
+    const uint16_t _port = 43439;
+    const std::string _multicastAddress = "239.255.255.250";
+
+    ResultCallback _resultCallback;
+    std::atomic_bool _stopped{true};
+    std::thread _listenThread;
+    BaseLib::PFileDescriptor _searchSocket;
+    BaseLib::PFileDescriptor _announcementSocket;
+    std::atomic_bool _receivingAnnouncements{false};
+    int _epollDescriptor = -1;
+    int _eventDescriptor = -1;
+
+    std::mutex _searchMutex;
+    std::atomic_bool _searching{false};
+    std::set<std::string> _expectedSerialNumbers;
+    std::set<std::string> _foundSerialNumbers;
+    int64_t _searchEndTime = 0;
+    int64_t _searchMinimumEndTime = 0;
+    FinishedCallback _finishedCallback;
+
+    BaseLib::PFileDescriptor createSearchSocket();
+    BaseLib::PFileDescriptor createAnnouncementSocket();
+    void wakeUp();
+    void listen();
+    void receive(const BaseLib::PFileDescriptor &socketDescriptor, bool searchResponse);
+    bool parse(const char *buffer, int32_t size, DiscoveredCcu &ccu);
+    void checkSearch();
+};
+
+}
+
+#endif
@@ -0,0 +1,243 @@
+/* Copyright 2013-2019 Homegear GmbH */
+
+#include "DescriptionCache.h"
+#include "DescriptionCreator.h"
+#include "GD.h"
+
+#include <cstring>
+#include <fstream>
+
+#include <sys/stat.h>
+
+namespace MyFamily
+{
+
+std::mutex DescriptionCache::_cacheMutex;
+
+DescriptionCache::DescriptionCache()
+{
+    std::string familyPath = GD::bl->settings.familyDataPath() + std::to_string(GD::family->getFamily()) + "/";
+    _xmlPath = familyPath + "desc/";
+    _cacheFilename = familyPath + "descriptions.cache";
+}
+
+int64_t DescriptionCache::getModificationTime(const std::string& filename)
+{
+    struct stat fileInfo{};
+    if(stat(filename.c_str(), &fileInfo) == -1) return -1;
+    return (int64_t)fileInfo.st_mtim.tv_sec * 1000000000 + fileInfo.st_mtim.tv_nsec;
+}
+
+std::vector<std::shared_ptr<HomegearDevice>> DescriptionCache::load(std::unordered_map<uint32_t, PVariable>& sources)
+{
+    std::vector<std::shared_ptr<HomegearDevice>> devices;
+    try
+    {
+        if(!BaseLib::Io::directoryExists(_xmlPath)) return devices;
+        BaseLib::Io io;
+        io.init(GD::bl);
+        auto files = io.getFiles(_xmlPath);
+
+        std::lock_guard<std::mutex> cacheGuard(_cacheMutex);
+        size_t recordCount = 0;
+        PVariable cache = read(recordCount);
+        PVariable usedCache = std::make_shared<Variable>(VariableType::tStruct);
+        DescriptionCreator descriptionCreator;
+        size_t backfilledCount = 0;
+        sources.clear();
+        sources.reserve(files.size());
+        for(auto& filename : files)
+        {
+            if(filename.size() < 5 || filename.compare(filename.size() - 4, 4, ".xml") != 0) continue;
+
+            int64_t modificationTime = getModificationTime(_xmlPath + filename);
+            auto entryIterator = cache->structValue->find(filename);
+            if(entryIterator != cache->structValue->end())
+            {
+                auto timeIterator = entryIterator->second->structValue->find("MTIME");
+                auto sourceIterator = entryIterator->second->structValue->find("SOURCE");
+                if(timeIterator != entryIterator->second->structValue->end() && sourceIterator != entryIterator->second->structValue->end() && timeIterator->second->integerValue64 == modificationTime)
+                {
+                    auto typeNumberIterator = sourceIterator->second->structValue->find("TYPE_NUMBER");
+                    if(typeNumberIterator != sourceIterator->second->structValue->end() && sources.emplace((uint32_t)typeNumberIterator->second->integerValue, sourceIterator->second).second)
+                    {
+                        usedCache->structValue->emplace(filename, entryIterator->second);
+                        continue;
+                    }
+                }
+            }
+
+            bool oldFormat = false;
+            auto device = std::make_shared<HomegearDevice>(GD::bl, _xmlPath + filename, oldFormat);
+            if(!device->loaded())
+            {
+                GD::out.printError("Error: Could not load device description " + _xmlPath + filename + ".");
+                continue;
+            }
+
+            //Add XML files without cache entry, e. g. from before the cache existed, so they are only parsed once. The description is created from the
+            //source like all other cached descriptions.
+            auto source = modificationTime == -1 ? PVariable() : descriptionCreator.createSource(device);
+            if(source && sources.emplace((uint32_t)source->structValue->at("TYPE_NUMBER")->integerValue, source).second)
+            {
+                PVariable entry = std::make_shared<Variable>(VariableType::tStruct);
+                entry->structValue->emplace("MTIME", std::make_shared<Variable>(modificationTime));
+                entry->structValue->emplace("SOURCE", source);
+                usedCache->structValue->emplace(filename, entry);
+                backfilledCount++;
+                continue;
+            }
+            devices.push_back(device);
+        }
+
+        //Drop replaced records and entries of deleted or changed files and add the new entries.
+        if(usedCache->structValue->size() != recordCount || backfilledCount > 0) write(usedCache);
+        if(backfilledCount > 0) GD::out.printInfo("Info: Added " + std::to_string(backfilledCount) + " device descriptions to the description cache.");
+        GD::out.printInfo("Info: Loaded " + std::to_string(devices.size()) + " device descriptions. " + std::to_string(sources.size()) + " descriptions are created from the description cache.");
+    }
+    catch(const std::exception& ex)
+    {
+        GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+    }
+    return devices;
+}
+
+void DescriptionCache::store(const std::string& filename, const PVariable& source)
+{
+    try
+    {
+        int64_t modificationTime = getModificationTime(_xmlPath + filename);
+        if(modificationTime == -1) return;
+
+        PVariable entry = std::make_shared<Variable>(VariableType::tStruct);
+        entry->structValue->emplace("MTIME", std::make_shared<Variable>(modificationTime));
+        entry->structValue->emplace("SOURCE", source);
+
+        std::vector<char> data;
+        appendRecord(data, filename, entry);
+
+        //Only the new record is written. The file is compacted by the next "load".
+        std::lock_guard<std::mutex> cacheGuard(_cacheMutex);
+        struct stat fileInfo{};
+        bool newFile = stat(_cacheFilename.c_str(), &fileInfo) == -1 || fileInfo.st_size == 0;
+        std::ofstream file(_cacheFilename, std::ios::out | std::ios::binary | std::ios::app);
+        if(!file)
+        {
+            GD::out.printError("Error: Could not write description cache " + _cacheFilename + ".");
+            return;
+        }
+        if(newFile) file.write(_magic.data(), _magic.size());
+        file.write(data.data(), data.size());
+        if(!file) GD::out.printError("Error: Could not write description cache " + _cacheFilename + ".");
+    }
+    catch(const std::exception& ex)
+    {
+        GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+    }
+}
+
+void DescriptionCache::appendRecord(std::vector<char>& data, const std::string& filename, const PVariable& entry)
+{
+    PVariable record = std::make_shared<Variable>(VariableType::tStruct);
+    record->structValue->emplace("FILENAME", std::make_shared<Variable>(filename));
+    record->structValue->emplace("ENTRY", entry);
+
+    std::vector<char> encodedRecord;
+    BaseLib::Rpc::RpcEncoder rpcEncoder(GD::bl);
+    rpcEncoder.encodeResponse(record, encodedRecord);
+
+    uint32_t size = encodedRecord.size();
+    data.reserve(data.size() + 4 + encodedRecord.size());
+    data.push_back((char)(size >> 24));
+    data.push_back((char)(size >> 16));
+    data.push_back((char)(size >> 8));
+    data.push_back((char)size);
+    data.insert(data.end(), encodedRecord.begin(), encodedRecord.end());
+}
+
+PVariable DescriptionCache::read(size_t& recordCount)
+{
+    recordCount = 0;
+    PVariable cache = std::make_shared<Variable>(VariableType::tStruct);
+    try
+    {
+        std::ifstream file(_cacheFilename, std::ios::in | std::ios::binary | std::ios::ate);
+        if(!file) return cache;
+        std::streamoff fileSize = file.tellg();
+        if(fileSize <= (std::streamoff)_magic.size()) return cache;
+
+        std::vector<char> data(fileSize);
+        file.seekg(0);
+        if(!file.read(data.data(), fileSize) || _magic.compare(0, _magic.size(), data.data(), _magic.size()) != 0)
+        {
+            GD::out.printWarning("Warning: Ignoring invalid description cache " + _cacheFilename + ".");
+            //Makes "load" replace the file.
+            recordCount = 1;
+            return cache;
+        }
+
+        BaseLib::Rpc::RpcDecoder rpcDecoder(GD::bl);
+        for(size_t position = _magic.size(); position + 4 <= data.size();)
+        {
+            size_t size = ((uint32_t)(uint8_t)data[position] << 24) | ((uint32_t)(uint8_t)data[position + 1] << 16) | ((uint32_t)(uint8_t)data[position + 2] << 8) | (uint32_t)(uint8_t)data[position + 3];
+            position += 4;
+            if(position + size > data.size())
+            {
+                GD::out.printWarning("Warning: Ignoring incomplete record in description cache " + _cacheFilename + ".");
+                recordCount++;
+                break;
+            }
+
+            auto record = rpcDecoder.decodeResponse(data, position);
+            position += size;
+            recordCount++;
+            if(!record || record->type != VariableType::tStruct || record->errorStruct) continue;
+            auto filenameIterator = record->structValue->find("FILENAME");
+            auto entryIterator = record->structValue->find("ENTRY");
+            if(filenameIterator == record->structValue->end() || entryIterator == record->structValue->end() || entryIterator->second->type != VariableType::tStruct) continue;
+            (*cache->structValue)[filenameIterator->second->stringValue] = entryIterator->second;
+        }
+    }
+    catch(const std::exception& ex)
+    {
+        GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+    }
+    return cache;
+}
+
+void DescriptionCache::write(const PVariable& cache)
+{
+    try
+    {
+        std::vector<char> data;
+        for(auto& entry : *cache->structValue)
+        {
+            appendRecord(data, entry.first, entry.second);
+        }
+
+        //Write to a temporary file first, so a crash never leaves a truncated cache behind.
+        std::string tempFilename = _cacheFilename + ".tmp";
+        {
+            std::ofstream file(tempFilename, std::ios::out | std::ios::binary | std::ios::trunc);
+            if(!file)
+            {
+                GD::out.printError("Error: Could not write description cache " + tempFilename + ".");
+                return;
+            }
+            file.write(_magic.data(), _magic.size());
+            file.write(data.data(), data.size());
+            if(!file)
+            {
+                GD::out.printError("Error: Could not write description cache " + tempFilename + ".");
+                return;
+            }
+        }
+        if(rename(tempFilename.c_str(), _cacheFilename.c_str()) == -1) GD::out.printError("Error: Could not rename description cache: " + std::string(strerror(errno)));
+    }
+    catch(const std::exception& ex)
+    {
+        GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+    }
+}
+
+}
@@ -0,0 +1,74 @@
+/* Copyright 2013-2019 Homegear GmbH */
+
+#ifndef HOMEGEAR_CCU_DESCRIPTIONCACHE_H
+#define HOMEGEAR_CCU_DESCRIPTIONCACHE_H
+
+#include <homegear-base/BaseLib.h>
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace MyFamily
+{
+
+using namespace BaseLib;
+using namespace BaseLib::DeviceDescription;
+
+/**
+ * Stores the data the device descriptions were created from in one binary file next to the "desc" directory. At startup the descriptions are rebuilt
+ * from this data, which is a lot faster than parsing the XML files. An entry is only used when the modification time of its XML file matches the one
+ * stored with the entry. Otherwise the XML file is parsed.
+ *
+ * The file consists of records, each prefixed with its length. New entries are appended, later records replace earlier ones with the same file name.
+ * "load" compacts the file when it contains replaced or stale records.
+ */
+class DescriptionCache
+{
+public:
+    DescriptionCache();
+    virtual ~DescriptionCache() = default;
+
+    /**
+     * Loads the device descriptions of the family. Descriptions with an up-to-date cache entry are not created. Only their sources are returned, so they
+     * can be created on demand with "DescriptionCreator::createDevice". XML files without a cache entry are parsed once and added to the cache.
+     *
+     * @param sources Filled with the sources of all cached descriptions by type number.
+     * @return Returns all descriptions without an up-to-date cache entry.
+     */
+    std::vector<std::shared_ptr<HomegearDevice>> load(std::unordered_map<uint32_t, PVariable>& sources);
+
+    /**
+     * Stores the source of a description by appending it to the cache file. Must be called after the XML file was written.
+     *
+     * @param filename The name of the XML file without path.
+     * @param source The source as passed to "DescriptionCreator::createDevice".
+     */
+    void store(const std::string& filename, const PVariable& source);
+private:
+    static std::mutex _cacheMutex;
+    const std::string _magic = "HGCCUDC2";
+    std::string _xmlPath;
+    std::string _cacheFilename;
+
+    int64_t getModificationTime(const std::string& filename);
+
+    /**
+     * Reads the cache file. Returns an empty struct when the file doesn't exist or is invalid. Records after an incomplete record, e. g. when Homegear
+     * stopped while appending, are ignored.
+     *
+     * @param[out] recordCount The number of records read, including replaced and invalid ones. When it differs from the number of entries returned,
+     * the file should be compacted.
+     */
+    PVariable read(size_t& recordCount);
+
+    /**
+     * Replaces the cache file with one record per entry.
+     */
+    void write(const PVariable& cache);
+    void appendRecord(std::vector<char>& data, const std::string& filename, const PVariable& entry);
+};
+
+}
+
+#endif
@@ -1,8 +1,13 @@
 /* Copyright 2013-2019 Homegear GmbH */
 
 #include "DescriptionCreator.h"
+#include "DescriptionCache.h"
 #include "GD.h"
 
+#include <cstring>
+
+#include <unistd.h>
+
 namespace MyFamily
 {
 
@@ -15,8 +20,6 @@ DescriptionCreator::PeerInfo DescriptionCreator::createDescription(Ccu::RpcType
 {
     try
     {
-        createDirectories();
-
         uint32_t typeId = 0;
         if(oldTypeNumber) typeId = oldTypeNumber;
         else
@@ -27,33 +30,110 @@ DescriptionCreator::PeerInfo DescriptionCreator::createDescription(Ccu::RpcType
         auto interface = GD::interfaces->getInterface(interfaceId);
         if(!interface) return PeerInfo();
 
+        bool changed = false;
+        auto source = createSource(rpcType, interface, serialNumber, typeId, PVariable(), changed);
+        if(!source || !saveDescription(serialNumber, source)) return PeerInfo();
+
+        PeerInfo peerInfo;
+        peerInfo.serialNumber = serialNumber;
+        peerInfo.type = typeId;
+        peerInfo.source = source;
+        return peerInfo;
+    }
+    catch(const std::exception& ex)
+    {
+        GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+    }
+    return PeerInfo();
+}
+
+DescriptionCreator::PeerInfo DescriptionCreator::updateDescription(Ccu::RpcType rpcType, std::string& interfaceId, std::string& serialNumber, uint32_t typeNumber, const PVariable& oldSource, bool& changed)
+{
+    changed = false;
+    try
+    {
+        auto interface = GD::interfaces->getInterface(interfaceId);
+        if(!interface) return PeerInfo();
+
+        auto source = createSource(rpcType, interface, serialNumber, typeNumber, oldSource, changed);
+        if(!source) return PeerInfo();
+        if(changed && !saveDescription(serialNumber, source)) return PeerInfo();
+
+        PeerInfo peerInfo;
+        peerInfo.serialNumber = serialNumber;
+        peerInfo.type = typeNumber;
+        peerInfo.source = source;
+        return peerInfo;
+    }
+    catch(const std::exception& ex)
+    {
+        GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+    }
+    return PeerInfo();
+}
+
+PVariable DescriptionCreator::createSource(Ccu::RpcType rpcType, std::shared_ptr<Ccu>& interface, std::string& serialNumber, uint32_t typeNumber, const PVariable& oldSource, bool& changed)
+{
+    try
+    {
         PArray parameters = std::make_shared<Array>();
         parameters->push_back(std::make_shared<Variable>(serialNumber));
         auto description = interface->invoke(rpcType, "getDeviceDescription", parameters);
         if(description->errorStruct)
         {
             GD::out.printError("Error: Could not call getDeviceDescription: " + description->structValue->at("faultString")->stringValue);
-            return PeerInfo();
+            return PVariable();
         }
 
-        std::shared_ptr<HomegearDevice> device = std::make_shared<HomegearDevice>(GD::bl);
+        //Parameter sets of the old source by channel, type and paramset ID.
+        std::unordered_map<std::string, PVariable> oldParamsets;
+        if(oldSource)
+        {
+            auto paramsetsIterator = oldSource->structValue->find("PARAMSETS");
+            if(paramsetsIterator != oldSource->structValue->end())
+            {
+                for(auto& paramset : *paramsetsIterator->second->arrayValue)
+                {
+                    auto channelIterator = paramset->structValue->find("CHANNEL");
+                    auto typeIterator = paramset->structValue->find("TYPE");
+                    auto idIterator = paramset->structValue->find("ID");
+                    if(channelIterator == paramset->structValue->end() || typeIterator == paramset->structValue->end() || idIterator == paramset->structValue->end()) continue;
+                    oldParamsets.emplace(std::to_string(channelIterator->second->integerValue) + "." + typeIterator->second->stringValue + "." + idIterator->second->stringValue, paramset);
+                }
+            }
+        }
+        else changed = true;
+
+        PVariable source = std::make_shared<Variable>(VariableType::tStruct);
+        PVariable paramsets = std::make_shared<Variable>(VariableType::tArray);
+        source->structValue->emplace("TYPE_NUMBER", std::make_shared<Variable>((int32_t)typeNumber));
+        source->structValue->emplace("PARAMSETS", paramsets);
+
         auto descriptionIterator = description->structValue->find("VERSION");
-        if(descriptionIterator != description->structValue->end()) device->version = descriptionIterator->second->integerValue;
+        source->structValue->emplace("VERSION", std::make_shared<Variable>(descriptionIterator != description->structValue->end() ? descriptionIterator->second->integerValue : 0));
 
-        PSupportedDevice supportedDevice = std::make_shared<SupportedDevice>(GD::bl);
+        descriptionIterator = description->structValue->find("FIRMWARE");
+        source->structValue->emplace("FIRMWARE", std::make_shared<Variable>(descriptionIterator != description->structValue->end() ? descriptionIterator->second->stringValue : ""));
+
+        std::string type;
         descriptionIterator = description->structValue->find("TYPE");
-        if(descriptionIterator != description->structValue->end()) supportedDevice->id = descriptionIterator->second->stringValue;
-        if(supportedDevice->id.empty()) supportedDevice->id = serialNumber;
-        supportedDevice->description = supportedDevice->id;
-        supportedDevice->typeNumber = typeId;
-        device->supportedDevices.push_back(supportedDevice);
+        if(descriptionIterator != description->structValue->end()) type = descriptionIterator->second->stringValue;
+        if(type.empty()) type = serialNumber;
+        source->structValue->emplace("TYPE", std::make_shared<Variable>(type));
+        source->structValue->emplace("DESCRIPTION", std::make_shared<Variable>(type));
 
+        uint32_t paramsetCount = 0;
         descriptionIterator = description->structValue->find("PARAMSETS");
         if(descriptionIterator != description->structValue->end())
         {
             for(auto& paramset : *descriptionIterator->second->arrayValue)
             {
-                addParameterSet(rpcType, interface, device, serialNumber, -1, paramset->stringValue);
+                auto paramsetSource = getParameterSet(rpcType, interface, serialNumber, -1, paramset->stringValue, oldParamsets, changed);
+                if(paramsetSource)
+                {
+                    paramsets->arrayValue->push_back(paramsetSource);
+                    paramsetCount++;
+                }
             }
         }
 
@@ -73,18 +153,77 @@ DescriptionCreator::PeerInfo DescriptionCreator::createDescription(Ccu::RpcType
                 {
                     for(auto& paramset : *parametersetIterator->second->arrayValue)
                     {
-                        addParameterSet(rpcType, interface, device, serialNumber, channel, paramset->stringValue);
+                        auto paramsetSource = getParameterSet(rpcType, interface, serialNumber, channel, paramset->stringValue, oldParamsets, changed);
+                        if(paramsetSource)
+                        {
+                            paramsets->arrayValue->push_back(paramsetSource);
+                            paramsetCount++;
+                        }
                     }
                 }
             }
         }
 
-        std::string filename = _xmlPath + serialNumber + ".xml";
-        device->save(filename);
+        if(oldSource && !changed)
+        {
+            //Parameter sets might have been removed or the device information might have changed.
+            auto paramsetsIterator = oldSource->structValue->find("PARAMSETS");
+            if(paramsetsIterator == oldSource->structValue->end() || paramsetsIterator->second->arrayValue->size() != paramsetCount) changed = true;
+            for(auto& element : {"VERSION", "FIRMWARE", "TYPE"})
+            {
+                auto oldIterator = oldSource->structValue->find(element);
+                if(oldIterator == oldSource->structValue->end() || *oldIterator->second != *source->structValue->at(element)) changed = true;
+            }
+        }
+
+        return source;
+    }
+    catch(const std::exception& ex)
+    {
+        GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+    }
+    return PVariable();
+}
+
+DescriptionCreator::PeerInfo DescriptionCreator::createSystemVariableDescription(std::string& serialNumber, int32_t version, PVariable parametersetDescription, uint32_t oldTypeNumber, std::unordered_set<uint64_t>& knownTypeNumbers)
+{
+    try
+    {
+        uint32_t typeId = 0;
+        if(oldTypeNumber) typeId = oldTypeNumber;
+        else
+        {
+            while(typeId == 0 || knownTypeNumbers.find(typeId) != knownTypeNumbers.end()) typeId++;
+        }
+
+        PVariable source = std::make_shared<Variable>(VariableType::tStruct);
+        PVariable paramsets = std::make_shared<Variable>(VariableType::tArray);
+        source->structValue->emplace("TYPE_NUMBER", std::make_shared<Variable>((int32_t)typeId));
+        source->structValue->emplace("VERSION", std::make_shared<Variable>(version));
+        source->structValue->emplace("TYPE", std::make_shared<Variable>(std::string("CCU-SYSTEM-VARIABLES")));
+        source->structValue->emplace("DESCRIPTION", std::make_shared<Variable>(std::string("CCU system variables")));
+        source->structValue->emplace("PARAMSETS", paramsets);
+
+        PVariable paramset = std::make_shared<Variable>(VariableType::tStruct);
+        paramset->structValue->emplace("CHANNEL", std::make_shared<Variable>(0));
+        paramset->structValue->emplace("TYPE", std::make_shared<Variable>(std::string("VALUES")));
+        paramset->structValue->emplace("ID", std::make_shared<Variable>(std::string("MAINTENANCE")));
+        paramset->structValue->emplace("DESCRIPTION", std::make_shared<Variable>(VariableType::tStruct));
+        paramsets->arrayValue->push_back(paramset);
+
+        paramset = std::make_shared<Variable>(VariableType::tStruct);
+        paramset->structValue->emplace("CHANNEL", std::make_shared<Variable>(1));
+        paramset->structValue->emplace("TYPE", std::make_shared<Variable>(std::string("VALUES")));
+        paramset->structValue->emplace("ID", std::make_shared<Variable>(std::string("SYSTEM_VARIABLES")));
+        paramset->structValue->emplace("DESCRIPTION", parametersetDescription ? parametersetDescription : std::make_shared<Variable>(VariableType::tStruct));
+        paramsets->arrayValue->push_back(paramset);
+
+        if(!saveDescription(serialNumber, source)) return PeerInfo();
 
         PeerInfo peerInfo;
         peerInfo.serialNumber = serialNumber;
         peerInfo.type = typeId;
+        peerInfo.source = source;
         return peerInfo;
     }
     catch(const std::exception& ex)
@@ -94,6 +233,254 @@ DescriptionCreator::PeerInfo DescriptionCreator::createDescription(Ccu::RpcType
     return PeerInfo();
 }
 
+std::shared_ptr<HomegearDevice> DescriptionCreator::createDevice(const PVariable& source)
+{
+    try
+    {
+        std::shared_ptr<HomegearDevice> device = std::make_shared<HomegearDevice>(GD::bl);
+        auto sourceIterator = source->structValue->find("VERSION");
+        if(sourceIterator != source->structValue->end()) device->version = sourceIterator->second->integerValue;
+
+        PSupportedDevice supportedDevice = std::make_shared<SupportedDevice>(GD::bl);
+        sourceIterator = source->structValue->find("TYPE");
+        if(sourceIterator != source->structValue->end()) supportedDevice->id = sourceIterator->second->stringValue;
+        sourceIterator = source->structValue->find("DESCRIPTION");
+        if(sourceIterator != source->structValue->end()) supportedDevice->description = sourceIterator->second->stringValue;
+        sourceIterator = source->structValue->find("TYPE_NUMBER");
+        if(sourceIterator != source->structValue->end()) supportedDevice->typeNumber = sourceIterator->second->integerValue;
+        device->supportedDevices.push_back(supportedDevice);
+
+        sourceIterator = source->structValue->find("PARAMSETS");
+        if(sourceIterator == source->structValue->end()) return device;
+        for(auto& paramset : *sourceIterator->second->arrayValue)
+        {
+            auto channelIterator = paramset->structValue->find("CHANNEL");
+            auto typeIterator = paramset->structValue->find("TYPE");
+            auto idIterator = paramset->structValue->find("ID");
+            auto descriptionIterator = paramset->structValue->find("DESCRIPTION");
+            if(channelIterator == paramset->structValue->end() || typeIterator == paramset->structValue->end() || idIterator == paramset->structValue->end() || descriptionIterator == paramset->structValue->end()) continue;
+            int32_t channel = channelIterator->second->integerValue;
+            std::string& type = typeIterator->second->stringValue;
+
+            auto functionIterator = device->functions.find(channel == -1 ? 0 : channel);
+            PFunction function = functionIterator == device->functions.end() ? std::make_shared<Function>(GD::bl) : functionIterator->second;
+            if(functionIterator == device->functions.end()) device->functions.emplace(channel == -1 ? 0 : channel, function);
+            function->channel = channel == -1 ? 0 : channel;
+            function->type = idIterator->second->stringValue;
+
+            BaseLib::DeviceDescription::PParameterGroup parameterGroup;
+            if(type == "VALUES")
+            {
+                parameterGroup = function->variables;
+                function->variablesId = "CCU_" + type + (channel == -1 ? "" : "_" + std::to_string(channel));
+            }
+            else if(type == "MASTER")
+            {
+                parameterGroup = function->configParameters;
+                function->configParametersId = "CCU_" + type + (channel == -1 ? "" : "_" + std::to_string(channel));
+            }
+            else if(type == "LINK")
+            {
+                parameterGroup = function->linkParameters;
+                function->linkParametersId = "CCU_" + type + (channel == -1 ? "" : "_" + std::to_string(channel));
+            }
+            else continue;
+
+            addParameters(parameterGroup, descriptionIterator->second);
+        }
+
+        return device;
+    }
+    catch(const std::exception& ex)
+    {
+        GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+    }
+    return std::shared_ptr<HomegearDevice>();
+}
+
+PVariable DescriptionCreator::createSource(const std::shared_ptr<HomegearDevice>& device)
+{
+    try
+    {
+        if(!device || device->supportedDevices.empty()) return PVariable();
+        auto& supportedDevice = device->supportedDevices.front();
+
+        PVariable source = std::make_shared<Variable>(VariableType::tStruct);
+        PVariable paramsets = std::make_shared<Variable>(VariableType::tArray);
+        source->structValue->emplace("TYPE_NUMBER", std::make_shared<Variable>((int32_t)supportedDevice->typeNumber));
+        source->structValue->emplace("VERSION", std::make_shared<Variable>((int32_t)device->version));
+        source->structValue->emplace("TYPE", std::make_shared<Variable>(supportedDevice->id));
+        source->structValue->emplace("DESCRIPTION", std::make_shared<Variable>(supportedDevice->description));
+        source->structValue->emplace("PARAMSETS", paramsets);
+
+        for(auto& function : device->functions)
+        {
+            for(auto& type : {"VALUES", "MASTER", "LINK"})
+            {
+                std::string typeString(type);
+                BaseLib::DeviceDescription::PParameterGroup parameterGroup;
+                if(typeString == "VALUES" && !function.second->variablesId.empty()) parameterGroup = function.second->variables;
+                else if(typeString == "MASTER" && !function.second->configParametersId.empty()) parameterGroup = function.second->configParameters;
+                else if(typeString == "LINK" && !function.second->linkParametersId.empty()) parameterGroup = function.second->linkParameters;
+                if(!parameterGroup) continue;
+
+                //"createDevice" stores the device's MASTER parameters in channel 0. Channel 0 has no MASTER parameters of its own.
+                int32_t channel = (typeString == "MASTER" && function.first == 0) ? -1 : (int32_t)function.first;
+
+                PVariable paramset = std::make_shared<Variable>(VariableType::tStruct);
+                paramset->structValue->emplace("CHANNEL", std::make_shared<Variable>(channel));
+                paramset->structValue->emplace("TYPE", std::make_shared<Variable>(typeString));
+                paramset->structValue->emplace("ID", std::make_shared<Variable>(function.second->type));
+                paramset->structValue->emplace("DESCRIPTION", getParametersetDescription(parameterGroup));
+                paramsets->arrayValue->push_back(paramset);
+            }
+        }
+
+        return source;
+    }
+    catch(const std::exception& ex)
+    {
+        GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+    }
+    return PVariable();
+}
+
+PVariable DescriptionCreator::getParametersetDescription(const BaseLib::DeviceDescription::PParameterGroup& parameterGroup)
+{
+    PVariable parametersetDescription = std::make_shared<Variable>(VariableType::tStruct);
+    try
+    {
+        for(auto& parameter : parameterGroup->parametersOrdered)
+        {
+            if(!parameter || !parameter->logical) continue;
+
+            PVariable description = std::make_shared<Variable>(VariableType::tStruct);
+            description->structValue->emplace("OPERATIONS", std::make_shared<Variable>((parameter->readable ? 5 : 0) | (parameter->writeable ? 2 : 0)));
+            description->structValue->emplace("FLAGS", std::make_shared<Variable>(1 | (parameter->internal ? 2 : 0) | (parameter->transform ? 4 : 0) | (parameter->service ? 8 : 0) | (parameter->sticky ? 16 : 0)));
+            if(!parameter->unit.empty()) description->structValue->emplace("UNIT", std::make_shared<Variable>(_utf8.toAnsi(parameter->unit)));
+
+            if(parameter->logical->type == ILogical::Type::Enum::tAction) description->structValue->emplace("TYPE", std::make_shared<Variable>(std::string("ACTION")));
+            else if(parameter->logical->type == ILogical::Type::Enum::tBoolean)
+            {
+                auto logical = std::dynamic_pointer_cast<LogicalBoolean>(parameter->logical);
+                description->structValue->emplace("TYPE", std::make_shared<Variable>(std::string("BOOL")));
+                if(logical && logical->defaultValueExists) description->structValue->emplace("DEFAULT", std::make_shared<Variable>(logical->defaultValue));
+            }
+            else if(parameter->logical->type == ILogical::Type::Enum::tInteger)
+            {
+                auto logical = std::dynamic_pointer_cast<LogicalInteger>(parameter->logical);
+                if(!logical) continue;
+                description->structValue->emplace("TYPE", std::make_shared<Variable>(std::string("INTEGER")));
+                if(logical->defaultValueExists) description->structValue->emplace("DEFAULT", std::make_shared<Variable>(logical->defaultValue));
+                description->structValue->emplace("MIN", std::make_shared<Variable>(logical->minimumValue));
+                description->structValue->emplace("MAX", std::make_shared<Variable>(logical->maximumValue));
+                if(!logical->specialValuesStringMap.empty())
+                {
+                    PVariable specialValues = std::make_shared<Variable>(VariableType::tArray);
+                    for(auto& specialValue : logical->specialValuesStringMap)
+                    {
+                        PVariable special = std::make_shared<Variable>(VariableType::tStruct);
+                        special->structValue->emplace("ID", std::make_shared<Variable>(specialValue.first));
+                        special->structValue->emplace("VALUE", std::make_shared<Variable>(specialValue.second));
+                        specialValues->arrayValue->push_back(special);
+                    }
+                    description->structValue->emplace("SPECIAL", specialValues);
+                }
+            }
+            else if(parameter->logical->type == ILogical::Type::Enum::tEnum)
+            {
+                auto logical = std::dynamic_pointer_cast<LogicalEnumeration>(parameter->logical);
+                if(!logical) continue;
+                description->structValue->emplace("TYPE", std::make_shared<Variable>(std::string("ENUM")));
+                if(logical->defaultValueExists) description->structValue->emplace("DEFAULT", std::make_shared<Variable>(logical->defaultValue));
+                description->structValue->emplace("MIN", std::make_shared<Variable>(logical->minimumValue));
+                description->structValue->emplace("MAX", std::make_shared<Variable>(logical->maximumValue));
+                PVariable valueList = std::make_shared<Variable>(VariableType::tArray);
+                valueList->arrayValue->reserve(logical->values.size());
+                for(auto& value : logical->values)
+                {
+                    valueList->arrayValue->push_back(std::make_shared<Variable>(value.id));
+                }
+                description->structValue->emplace("VALUE_LIST", valueList);
+            }
+            else if(parameter->logical->type == ILogical::Type::Enum::tFloat)
+            {
+                auto logical = std::dynamic_pointer_cast<LogicalDecimal>(parameter->logical);
+                if(!logical) continue;
+                description->structValue->emplace("TYPE", std::make_shared<Variable>(std::string("FLOAT")));
+                if(logical->defaultValueExists) description->structValue->emplace("DEFAULT", std::make_shared<Variable>(logical->defaultValue));
+                description->structValue->emplace("MIN", std::make_shared<Variable>(logical->minimumValue));
+                description->structValue->emplace("MAX", std::make_shared<Variable>(logical->maximumValue));
+                if(!logical->specialValuesStringMap.empty())
+                {
+                    PVariable specialValues = std::make_shared<Variable>(VariableType::tArray);
+                    for(auto& specialValue : logical->specialValuesStringMap)
+                    {
+                        PVariable special = std::make_shared<Variable>(VariableType::tStruct);
+                        special->structValue->emplace("ID", std::make_shared<Variable>(specialValue.first));
+                        special->structValue->emplace("VALUE", std::make_shared<Variable>((int32_t)specialValue.second));
+                        specialValues->arrayValue->push_back(special);
+                    }
+                    description->structValue->emplace("SPECIAL", specialValues);
+                }
+            }
+            else if(parameter->logical->type == ILogical::Type::Enum::tString) description->structValue->emplace("TYPE", std::make_shared<Variable>(std::string("STRING")));
+            else continue;
+
+            parametersetDescription->structValue->emplace(parameter->id, description);
+        }
+    }
+    catch(const std::exception& ex)
+    {
+        GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+    }
+    return parametersetDescription;
+}
+
+bool DescriptionCreator::saveDescription(const std::string& serialNumber, const PVariable& source)
+{
+    try
+    {
+        createDirectories();
+
+        auto device = createDevice(source);
+        if(!device) return false;
+        std::string filename = _xmlPath + serialNumber + ".xml";
+        device->save(filename);
+
+        DescriptionCache descriptionCache;
+        descriptionCache.store(serialNumber + ".xml", source);
+        return true;
+    }
+    catch(const std::exception& ex)
+    {
+        GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+    }
+    return false;
+}
+
+bool DescriptionCreator::renameDescription(const std::string& oldSerialNumber, const std::string& newSerialNumber, const PVariable& source)
+{
+    try
+    {
+        if(source && !saveDescription(newSerialNumber, source)) return false;
+
+        createDirectories();
+        std::string filename = _xmlPath + oldSerialNumber + ".xml";
+        if(BaseLib::Io::fileExists(filename) && unlink(filename.c_str()) == -1)
+        {
+            GD::out.printWarning("Warning: Could not delete " + filename + ": " + std::string(strerror(errno)));
+            return false;
+        }
+        return true;
+    }
+    catch(const std::exception& ex)
+    {
+        GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+    }
+    return false;
+}
+
 void DescriptionCreator::createDirectories()
 {
     try
@@ -134,11 +521,12 @@ void DescriptionCreator::createDirectories()
     }
 }
 
-void DescriptionCreator::addParameterSet(Ccu::RpcType rpcType, std::shared_ptr<Ccu>& interface, std::shared_ptr<HomegearDevice>& device, std::string& serialNumber, int32_t channel, std::string& type)
+PVariable DescriptionCreator::getParameterSet(Ccu::RpcType rpcType, std::shared_ptr<Ccu>& interface, std::string& serialNumber, int32_t channel, std::string& type, const std::unordered_map<std::string, PVariable>& oldParamsets, bool& fetched)
 {
     try
     {
-        if(type == "MASTER" && channel == 0) return;
+        if(type == "MASTER" && channel == 0) return PVariable();
+        if(type != "VALUES" && type != "MASTER" && type != "LINK") return PVariable();
 
         std::string methodName = "getParamsetId";
         PArray parameters = std::make_shared<Array>();
@@ -149,41 +537,40 @@ void DescriptionCreator::addParameterSet(Ccu::RpcType rpcType, std::shared_ptr<C
         if(paramsetId->errorStruct)
         {
             GD::out.printWarning("Warning: Could not call getParamsetId on channel " + std::to_string(channel));
-            return;
+            return PVariable();
         }
 
+        //The paramset ID changes with the parameters, so the description of known IDs doesn't need to be fetched again.
+        auto oldParamsetIterator = oldParamsets.find(std::to_string(channel) + "." + type + "." + paramsetId->stringValue);
+        if(oldParamsetIterator != oldParamsets.end()) return oldParamsetIterator->second;
+        fetched = true;
+
         methodName = "getParamsetDescription";
         auto parametersetDescription = interface->invoke(rpcType, methodName, parameters);
         if(parametersetDescription->errorStruct)
         {
             GD::out.printWarning("Warning: Could not call getParamsetDescription on channel " + std::to_string(channel));
-            return;
+            return PVariable();
         }
 
-        auto functionIterator = device->functions.find(channel == -1 ? 0 : channel);
-        PFunction function = functionIterator == device->functions.end() ? std::make_shared<Function>(GD::bl) : functionIterator->second;
-        if(functionIterator == device->functions.end()) device->functions.emplace(channel == -1 ? 0 : channel, function);
-        function->channel = channel == -1 ? 0 : channel;
-        function->type = paramsetId->stringValue;
-
-        BaseLib::DeviceDescription::PParameterGroup parameterGroup;
-        if(type == "VALUES")
-        {
-            parameterGroup = function->variables;
-            function->variablesId = "CCU_" + type + (channel == -1 ? "" : "_" + std::to_string(channel));
-        }
-        else if(type == "MASTER")
-        {
-            parameterGroup = function->configParameters;
-            function->configParametersId = "CCU_" + type + (channel == -1 ? "" : "_" + std::to_string(channel));
-        }
-        else if(type == "LINK")
-        {
-            parameterGroup = function->linkParameters;
-            function->linkParametersId = "CCU_" + type + (channel == -1 ? "" : "_" + std::to_string(channel));
-        }
-        else return;
+        PVariable paramset = std::make_shared<Variable>(VariableType::tStruct);
+        paramset->structValue->emplace("CHANNEL", std::make_shared<Variable>(channel));
+        paramset->structValue->emplace("TYPE", std::make_shared<Variable>(type));
+        paramset->structValue->emplace("ID", std::make_shared<Variable>(paramsetId->stringValue));
+        paramset->structValue->emplace("DESCRIPTION", parametersetDescription);
+        return paramset;
+    }
+    catch(const std::exception& ex)
+    {
+        GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+    }
+    return PVariable();
+}
 
+void DescriptionCreator::addParameters(BaseLib::DeviceDescription::PParameterGroup& parameterGroup, const PVariable& parametersetDescription)
+{
+    try
+    {
         for(auto& parameterDescription : *parametersetDescription->structValue)
         {
             PParameter parameter = std::make_shared<Parameter>(GD::bl, parameterGroup);
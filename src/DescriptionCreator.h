@@ -9,6 +9,8 @@
 
 #include <sys/stat.h>
 
+#include <unordered_map>
+
 namespace MyFamily
 {
 
@@ -20,18 +22,97 @@ public:
         std::string serialNumber;
         int32_t type = -1;
         int32_t firmwareVersion = 0x10;
+
+        /**
+         * The source of the description as passed to "createDevice".
+         */
+        PVariable source;
     };
 
     DescriptionCreator();
     virtual ~DescriptionCreator() = default;
 
     DescriptionCreator::PeerInfo createDescription(Ccu::RpcType rpcType, std::string& interfaceId, std::string& serialNumber, uint32_t oldTypeNumber, std::unordered_set<uint64_t>& knownTypeNumbers);
+
+    /**
+     * Updates the description of a device, e. g. after a firmware update. Only parameter sets with an unknown paramset ID are fetched from the CCU. All
+     * other parameter sets are taken from the current description. The description is only saved when it changed.
+     *
+     * @param typeNumber The type number of the current description.
+     * @param oldSource The source of the current description.
+     * @param[out] changed Set to true when the description changed.
+     */
+    DescriptionCreator::PeerInfo updateDescription(Ccu::RpcType rpcType, std::string& interfaceId, std::string& serialNumber, uint32_t typeNumber, const PVariable& oldSource, bool& changed);
+
+    /**
+     * Creates the description of the virtual peer holding the system variables of a CCU. Channel 1 contains one VALUES parameter per system variable.
+     *
+     * @param version The version to store in the description. Used to detect changes of the system variable definitions.
+     * @param parametersetDescription The parameters in the format returned by "getParamsetDescription".
+     */
+    DescriptionCreator::PeerInfo createSystemVariableDescription(std::string& serialNumber, int32_t version, PVariable parametersetDescription, uint32_t oldTypeNumber, std::unordered_set<uint64_t>& knownTypeNumbers);
+
+    /**
+     * Moves a description to a new serial number, e. g. after a device was replaced on the CCU. The type number stays the same.
+     *
+     * @param source The source of the description. When nullptr, only the file of the old serial number is deleted.
+     */
+    bool renameDescription(const std::string& oldSerialNumber, const std::string& newSerialNumber, const PVariable& source);
+
+    /**
+     * Builds a device description from the data collected from the CCU. No network access or XML parsing is needed, so this is also used to restore
+     * descriptions from the description cache.
+     *
+     * @param source A struct with "TYPE_NUMBER", "VERSION", "TYPE", "DESCRIPTION" and "PARAMSETS". Each element of "PARAMSETS" contains "CHANNEL"
+     * (-1 for the device), "TYPE" ("VALUES", "MASTER" or "LINK"), "ID" (the paramset ID) and "DESCRIPTION" (as returned by "getParamsetDescription").
+     */
+    std::shared_ptr<HomegearDevice> createDevice(const PVariable& source);
+
+    /**
+     * Reverses "createDevice" for descriptions only available as XML file, e. g. ones created before the description cache existed. "createDevice"
+     * creates an equivalent description from the returned source. Paramset IDs and "FIRMWARE" are not stored in the XML file, so the first call to
+     * "updateDescription" fetches the parameter sets from the CCU again.
+     *
+     * @return Returns the source or nullptr on errors.
+     */
+    PVariable createSource(const std::shared_ptr<HomegearDevice>& device);
 private:
     std::string _xmlPath;
     BaseLib::Ansi _ansi{true, false};
+    BaseLib::Ansi _utf8{false, true};
 
     void createDirectories();
-    void addParameterSet(Ccu::RpcType rpcType, std::shared_ptr<Ccu>& interface, std::shared_ptr<HomegearDevice>& device, std::string& serialNumber, int32_t channel, std::string& type);
+
+    /**
+     * Writes the XML file of the description and stores the source in the description cache.
+     */
+    bool saveDescription(const std::string& serialNumber, const PVariable& source);
+    void addParameters(BaseLib::DeviceDescription::PParameterGroup& parameterGroup, const PVariable& parametersetDescription);
+
+    /**
+     * Reverses "addParameters".
+     *
+     * @return Returns the parameters in the format returned by "getParamsetDescription".
+     */
+    PVariable getParametersetDescription(const BaseLib::DeviceDescription::PParameterGroup& parameterGroup);
+
+    /**
+     * Collects the source of a device description from the CCU.
+     *
+     * @param oldSource The source of the current description or nullptr. Parameter sets with unchanged IDs are taken from it.
+     * @param[out] changed Set to true when the source differs from "oldSource".
+     * @return Returns the source or nullptr on errors.
+     */
+    PVariable createSource(Ccu::RpcType rpcType, std::shared_ptr<Ccu>& interface, std::string& serialNumber, uint32_t typeNumber, const PVariable& oldSource, bool& changed);
+
+    /**
+     * Fetches the ID and the description of a parameter set from the CCU.
+     *
+     * @param oldParamsets Known parameter sets by "<channel>.<type>.<paramset ID>". The description of known parameter sets is not fetched.
+     * @param[out] fetched Set to true when the description was fetched from the CCU.
+     * @return Returns an element for "PARAMSETS" of the source passed to "createDevice" or nullptr on errors.
+     */
+    PVariable getParameterSet(Ccu::RpcType rpcType, std::shared_ptr<Ccu>& interface, std::string& serialNumber, int32_t channel, std::string& type, const std::unordered_map<std::string, PVariable>& oldParamsets, bool& fetched);
 };
 
 }
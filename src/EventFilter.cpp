@@ -0,0 +1,104 @@
+/* Copyright 2013-2019 Homegear GmbH */
+
+#include "EventFilter.h"
+#include "GD.h"
+
+#include <sstream>
+
+#include <fnmatch.h>
+
+namespace MyFamily
+{
+
+EventFilter::EventFilter()
+{
+    loadRules();
+}
+
+void EventFilter::loadRules()
+{
+    try
+    {
+        std::string settingName = "eventFilter";
+        auto setting = GD::family->getFamilySetting(settingName);
+        if(!setting || setting->stringValue.empty()) return;
+
+        auto entries = BaseLib::HelperFunctions::splitAll(setting->stringValue, ',');
+        for(auto& entry : entries)
+        {
+            BaseLib::HelperFunctions::trim(entry);
+            if(entry.empty()) continue;
+            std::vector<std::string> fields;
+            std::istringstream stream(entry);
+            std::string field;
+            while(stream >> field)
+            {
+                fields.push_back(field);
+            }
+            if(fields.size() != 4)
+            {
+                GD::out.printWarning("Warning: Ignoring invalid event filter rule \"" + entry + "\".");
+                continue;
+            }
+
+            Rule rule;
+            BaseLib::HelperFunctions::toLower(fields.at(0));
+            if(fields.at(0) == "drop") rule.action = Action::drop;
+            else if(fields.at(0) == "memory") rule.action = Action::memory;
+            else if(fields.at(0) == "persist") rule.action = Action::persist;
+            else if(fields.at(0) == "none") rule.action = Action::none;
+            else
+            {
+                GD::out.printWarning("Warning: Ignoring event filter rule with unknown action \"" + entry + "\".");
+                continue;
+            }
+            rule.deviceType = fields.at(1);
+            rule.address = fields.at(2);
+            rule.parameter = fields.at(3);
+            _rules.push_back(std::move(rule));
+        }
+
+        if(!_rules.empty()) GD::out.printInfo("Info: Loaded " + std::to_string(_rules.size()) + " event filter rules.");
+    }
+    catch(const std::exception& ex)
+    {
+        GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+    }
+}
+
+EventFilter::Action EventFilter::getAction(const std::string& address, const std::string& parameter, const std::function<std::string()>& getDeviceType)
+{
+    try
+    {
+        if(_rules.empty()) return Action::none;
+
+        std::string key = address + "." + parameter;
+        std::lock_guard<std::mutex> cacheGuard(_cacheMutex);
+        auto cacheIterator = _cache.find(key);
+        if(cacheIterator != _cache.end()) return cacheIterator->second;
+
+        std::string deviceType = getDeviceType();
+        Action action = Action::none;
+        for(auto& rule : _rules)
+        {
+            if(fnmatch(rule.parameter.c_str(), parameter.c_str(), 0) != 0 || fnmatch(rule.address.c_str(), address.c_str(), 0) != 0 || fnmatch(rule.deviceType.c_str(), deviceType.c_str(), 0) != 0) continue;
+            action = rule.action;
+            break;
+        }
+        _cache.emplace(key, action);
+        return action;
+    }
+    catch(const std::exception& ex)
+    {
+        GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+    }
+    return Action::none;
+}
+
+void EventFilter::clearCache()
+{
+    std::lock_guard<std::mutex> cacheGuard(_cacheMutex);
+    _cache.clear();
+}
+
+}
@@ -0,0 +1,81 @@
+/* Copyright 2013-2019 Homegear GmbH */
+
+#ifndef HOMEGEAR_CCU_EVENTFILTER_H
+#define HOMEGEAR_CCU_EVENTFILTER_H
+
+#include <homegear-base/BaseLib.h>
+
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+
+namespace MyFamily
+{
+
+/**
+ * Filters datapoint events received from a CCU before they are processed. The rules are read from the family setting "eventFilter" in the format
+ * "ACTION DEVICE_TYPE ADDRESS PARAMETER, ...". Device type, address and parameter are shell wildcard patterns. The first matching rule wins.
+ */
+class EventFilter
+{
+public:
+    enum class Action
+    {
+        /**
+         * The event is processed normally.
+         */
+        none,
+
+        /**
+         * The event is dropped before it is passed to the central.
+         */
+        drop,
+
+        /**
+         * Only the value in memory is updated. The value is not stored in the database and no events are raised.
+         */
+        memory,
+
+        /**
+         * The value is updated and stored in the database, but no events are raised.
+         */
+        persist
+    };
+
+    EventFilter();
+    virtual ~EventFilter() = default;
+
+    bool empty() { return _rules.empty(); }
+
+    /**
+     * Returns the action for a datapoint. The result is cached per address and parameter.
+     *
+     * @param address The channel address.
+     * @param parameter The name of the datapoint.
+     * @param getDeviceType Returns the type of the device as returned by "getDeviceDescription". Only called when the action is not cached.
+     */
+    Action getAction(const std::string& address, const std::string& parameter, const std::function<std::string()>& getDeviceType);
+
+    /**
+     * Clears the cached actions, e. g. after device types changed.
+     */
+    void clearCache();
+private:
+    struct Rule
+    {
+        Action action = Action::none;
+        std::string deviceType;
+        std::string address;
+        std::string parameter;
+    };
+
+    std::vector<Rule> _rules;
+    std::mutex _cacheMutex;
+    std::unordered_map<std::string, Action> _cache;
+
+    void loadRules();
+};
+
+}
+
+#endif
@@ -0,0 +1,241 @@
+/* Copyright 2013-2019 Homegear GmbH
+ *
+ * Homegear is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Homegear is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Homegear.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ */
+
+#include "EventQueue.h"
+#include "GD.h"
+
+#include <fnmatch.h>
+
+namespace MyFamily {
+
+EventQueue::EventQueue(DispatchCallback dispatchCallback) {
+  _dispatchCallback.swap(dispatchCallback);
+  loadRules();
+
+  std::string settingName = "eventQueueSize";
+  auto setting = GD::family->getFamilySetting(settingName);
+  if (setting && setting->integerValue > 0) _maxQueueSize = setting->integerValue;
+}
+
+EventQueue::~EventQueue() {
+  stop();
+}
+
+void EventQueue::loadRules() {
+  try {
+    std::string settingName = "eventPriorities";
+    auto setting = GD::family->getFamilySetting(settingName);
+    if (setting) {
+      //Format: "PARAMETER:CLASS, PARAMETER:CLASS". Configured rules are checked before the default rules.
+      auto entries = BaseLib::HelperFunctions::splitAll(setting->stringValue, ',');
+      for (auto &entry : entries) {
+        auto pair = BaseLib::HelperFunctions::splitLast(entry, ':');
+        BaseLib::HelperFunctions::trim(pair.first);
+        BaseLib::HelperFunctions::trim(pair.second);
+        BaseLib::HelperFunctions::toLower(pair.second);
+        if (pair.first.empty()) continue;
+        if (pair.second == "alarm") _rules.emplace_back(pair.first, Priority::alarm);
+        else if (pair.second == "button") _rules.emplace_back(pair.first, Priority::button);
+        else if (pair.second == "state") _rules.emplace_back(pair.first, Priority::state);
+        else if (pair.second == "measurement") _rules.emplace_back(pair.first, Priority::measurement);
+        else if (pair.second == "diagnostic") _rules.emplace_back(pair.first, Priority::diagnostic);
+        else GD::out.printWarning("Warning: Ignoring event priority with unknown class \"" + entry + "\".");
+      }
+    }
+
+    _rules.emplace_back("*ALARM*", Priority::alarm);
+    _rules.emplace_back("SMOKE_DETECTOR*", Priority::alarm);
+    _rules.emplace_back("WATERLEVEL_DETECTED", Priority::alarm);
+    _rules.emplace_back("SABOTAGE", Priority::alarm);
+    _rules.emplace_back("PRESS_*", Priority::button);
+    _rules.emplace_back("*_DIAG", Priority::diagnostic);
+    _rules.emplace_back("RSSI_*", Priority::diagnostic);
+    _rules.emplace_back("OPERATING_VOLTAGE*", Priority::diagnostic);
+    _rules.emplace_back("LOW_BAT", Priority::diagnostic);
+    _rules.emplace_back("LOWBAT", Priority::diagnostic);
+    _rules.emplace_back("UNREACH", Priority::diagnostic);
+    _rules.emplace_back("STICKY_UNREACH", Priority::diagnostic);
+    _rules.emplace_back("CONFIG_PENDING", Priority::diagnostic);
+    _rules.emplace_back("UPDATE_PENDING", Priority::diagnostic);
+    _rules.emplace_back("DUTY_CYCLE*", Priority::diagnostic);
+    _rules.emplace_back("CARRIER_SENSE*", Priority::diagnostic);
+    _rules.emplace_back("ERROR_CODE", Priority::diagnostic);
+    _rules.emplace_back("ACTUAL_TEMPERATURE*", Priority::measurement);
+    _rules.emplace_back("*HUMIDITY*", Priority::measurement);
+    _rules.emplace_back("*ILLUMINATION*", Priority::measurement);
+    _rules.emplace_back("*BRIGHTNESS*", Priority::measurement);
+    _rules.emplace_back("POWER", Priority::measurement);
+    _rules.emplace_back("CURRENT", Priority::measurement);
+    _rules.emplace_back("VOLTAGE", Priority::measurement);
+    _rules.emplace_back("FREQUENCY", Priority::measurement);
+    _rules.emplace_back("ENERGY_COUNTER*", Priority::measurement);
+    _rules.emplace_back("GAS_*", Priority::measurement);
+    _rules.emplace_back("IEC_*", Priority::measurement);
+    _rules.emplace_back("WIND_*", Priority::measurement);
+    _rules.emplace_back("RAIN_COUNTER", Priority::measurement);
+  }
+  catch (const std::exception &ex) {
+    GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+  }
+}
+
+EventQueue::Priority EventQueue::getPriority(const std::string &parameter) {
+  try {
+    std::lock_guard<std::mutex> priorityCacheGuard(_priorityCacheMutex);
+    auto cacheIterator = _priorityCache.find(parameter);
+    if (cacheIterator != _priorityCache.end()) return cacheIterator->second;
+
+    Priority priority = Priority::state;
+    for (auto &rule : _rules) {
+      if (fnmatch(rule.first.c_str(), parameter.c_str(), 0) == 0) {
+        priority = rule.second;
+        break;
+      }
+    }
+    _priorityCache.emplace(parameter, priority);
+    return priority;
+  }
+  catch (const std::exception &ex) {
+    GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+  }
+  return Priority::state;
+}
+
+void EventQueue::start() {
+  try {
+    stop();
+    _stopped = false;
+    GD::bl->threadManager.start(_dispatchThread, true, &EventQueue::dispatch, this);
+  }
+  catch (const std::exception &ex) {
+    GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+  }
+}
+
+void EventQueue::stop() {
+  try {
+    {
+      std::lock_guard<std::mutex> queuesGuard(_queuesMutex);
+      _stopped = true;
+    }
+    _queuesConditionVariable.notify_all();
+    GD::bl->threadManager.join(_dispatchThread);
+
+    std::lock_guard<std::mutex> queuesGuard(_queuesMutex);
+    for (auto &queue : _queues) {
+      queue.clear();
+    }
+    _queueSize = 0;
+    _dispatchedSinceOverdue = 0;
+  }
+  catch (const std::exception &ex) {
+    GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+  }
+}
+
+void EventQueue::push(const PMyPacket &packet) {
+  try {
+    auto parameters = packet->getParameters();
+    Priority priority = parameters->size() >= 3 ? getPriority(parameters->at(2)->stringValue) : Priority::state;
+    {
+      std::lock_guard<std::mutex> queuesGuard(_queuesMutex);
+      if (_stopped) return;
+      int64_t time = BaseLib::HelperFunctions::getTime();
+      if (_queueSize >= _maxQueueSize) {
+        size_t lowestQueue = _priorityCount - 1;
+        while (lowestQueue > 0 && _queues.at(lowestQueue).empty()) lowestQueue--;
+        _droppedEvents++;
+        if (time - _lastDropWarning > 10000) {
+          _lastDropWarning = time;
+          GD::out.printWarning("Warning: Event queue is full (" + std::to_string(_maxQueueSize) + " events). Dropped " + std::to_string(_droppedEvents) + " events.");
+          _droppedEvents = 0;
+        }
+        if (lowestQueue < (size_t)priority) return;
+        _queues.at(lowestQueue).pop_front();
+        _queueSize--;
+      }
+      _queues.at((size_t)priority).emplace_back(time, packet);
+      _queueSize++;
+    }
+    _queuesConditionVariable.notify_one();
+  }
+  catch (const std::exception &ex) {
+    GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+  }
+}
+
+void EventQueue::dispatch() {
+  while (!_stopped) {
+    try {
+      PMyPacket packet;
+      {
+        std::unique_lock<std::mutex> queuesGuard(_queuesMutex);
+        _queuesConditionVariable.wait(queuesGuard, [&] {
+          if (_stopped) return true;
+          for (auto &queue : _queues) {
+            if (!queue.empty()) return true;
+          }
+          return false;
+        });
+        if (_stopped) return;
+
+        //Take the highest class. After "_overdueInterval" events, an event of a lower class waiting too long is taken instead. Among those the
+        //oldest one wins.
+        size_t selectedQueue = 0;
+        while (selectedQueue < _priorityCount && _queues.at(selectedQueue).empty()) selectedQueue++;
+        if (selectedQueue == _priorityCount) continue;
+
+        if (_dispatchedSinceOverdue >= _overdueInterval) {
+          int64_t oldestOverdue = BaseLib::HelperFunctions::getTime() - _maxWaitTime;
+          size_t overdueQueue = _priorityCount;
+          for (size_t i = selectedQueue + 1; i < _priorityCount; i++) {
+            if (_queues.at(i).empty() || _queues.at(i).front().first >= oldestOverdue) continue;
+            overdueQueue = i;
+            oldestOverdue = _queues.at(i).front().first;
+          }
+          if (overdueQueue != _priorityCount) {
+            selectedQueue = overdueQueue;
+            _dispatchedSinceOverdue = 0;
+          }
+        } else _dispatchedSinceOverdue++;
+
+        packet = std::move(_queues.at(selectedQueue).front().second);
+        _queues.at(selectedQueue).pop_front();
+        _queueSize--;
+      }
+
+      _dispatchCallback(packet);
+    }
+    catch (const std::exception &ex) {
+      GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+    }
+  }
+}
+
+}
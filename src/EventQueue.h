@@ -0,0 +1,117 @@
+/* Copyright 2013-2019 Homegear GmbH
+ *
+ * Homegear is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Homegear is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Homegear.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ */
+
+#ifndef HOMEGEAR_CCU_EVENTQUEUE_H
+#define HOMEGEAR_CCU_EVENTQUEUE_H
+
+#include "MyPacket.h"
+#include <homegear-base/BaseLib.h>
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace MyFamily
+{
+
+/**
+ * Dispatches "event" calls received from a CCU by priority. Events are queued in one queue per priority class and dispatched by a background thread,
+ * so the receive thread is not blocked by event processing. The highest nonempty class is dispatched first. Once the oldest event of a lower class
+ * waited longer than "_maxWaitTime", it is dispatched after at most "_overdueInterval" events of higher classes. That way lower classes are delayed but
+ * never starved, and higher classes keep most of the throughput under sustained load.
+ *
+ * The total number of queued events is limited by the family setting "eventQueueSize". When the limit is reached, the oldest event of the lowest
+ * nonempty class is dropped, or the new event if its class is lower than that.
+ *
+ * The class of a parameter is read from the family setting "eventPriorities" in the format "PARAMETER:CLASS, ..." where "PARAMETER" can contain
+ * wildcards. Parameters not matching any configured or default rule are in class "state".
+ */
+class EventQueue
+{
+public:
+    enum class Priority : int32_t
+    {
+        alarm = 0,
+        button = 1,
+        state = 2,
+        measurement = 3,
+        diagnostic = 4
+    };
+
+    typedef std::function<void(PMyPacket& packet)> DispatchCallback;
+
+    EventQueue(DispatchCallback dispatchCallback);
+    virtual ~EventQueue();
+
+    void start();
+    void stop();
+
+    /**
+     * Queues an "event" call.
+     */
+    void push(const PMyPacket& packet);
+
+    /**
+     * Returns the priority class of a parameter.
+     */
+    Priority getPriority(const std::string& parameter);
+private:
+    static const size_t _priorityCount = 5;
+    const int64_t _maxWaitTime = 1000;
+    const uint32_t _overdueInterval = 8;
+    size_t _maxQueueSize = 10000;
+
+    DispatchCallback _dispatchCallback;
+    std::atomic_bool _stopped{true};
+    std::thread _dispatchThread;
+
+    std::mutex _queuesMutex;
+    std::condition_variable _queuesConditionVariable;
+    std::array<std::deque<std::pair<int64_t, PMyPacket>>, _priorityCount> _queues;
+    size_t _queueSize = 0;
+    uint32_t _dispatchedSinceOverdue = 0;
+    uint32_t _droppedEvents = 0;
+    int64_t _lastDropWarning = 0;
+
+    std::vector<std::pair<std::string, Priority>> _rules;
+    std::mutex _priorityCacheMutex;
+    std::unordered_map<std::string, Priority> _priorityCache;
+
+    void loadRules();
+    void dispatch();
+};
+
+}
+
+#endif
@@ -80,16 +80,42 @@ void Interfaces::removeEventHandlers()
     }
 }
 
-std::vector<std::shared_ptr<Ccu>> Interfaces::getInterfaces()
+void Interfaces::publishSnapshot()
 {
-    std::vector<std::shared_ptr<Ccu>> interfaces;
     try
     {
-        std::lock_guard<std::mutex> interfaceGuard(_physicalInterfacesMutex);
-        for(auto interfaceBase : _physicalInterfaces)
+        auto snapshot = std::make_shared<InterfacesSnapshot>();
+        snapshot->generation = _generation.load(std::memory_order_relaxed) + 1;
+        snapshot->defaultInterface = _defaultPhysicalInterface;
+        snapshot->interfaces.reserve(_physicalInterfaces.size());
+        for(auto& interfaceBase : _physicalInterfaces)
         {
             std::shared_ptr<Ccu> interface(std::dynamic_pointer_cast<Ccu>(interfaceBase.second));
             if(!interface) continue;
+            snapshot->interfaces.push_back(interface);
+            snapshot->interfacesById.emplace(interfaceBase.first, interface);
+            if(!interface->getSerialNumber().empty()) snapshot->interfacesBySerial.emplace(interface->getSerialNumber(), interface);
+            std::string host = interface->getHost();
+            if(!host.empty()) snapshot->interfacesByIp.emplace(host, interface);
+        }
+        std::atomic_store(&_snapshot, std::shared_ptr<const InterfacesSnapshot>(std::move(snapshot)));
+        _generation.fetch_add(1, std::memory_order_release);
+    }
+    catch(const std::exception& ex)
+    {
+        GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+    }
+}
+
+std::vector<std::shared_ptr<Ccu>> Interfaces::getInterfaces()
+{
+    std::vector<std::shared_ptr<Ccu>> interfaces;
+    try
+    {
+        auto snapshot = getSnapshot();
+        interfaces.reserve(snapshot->interfaces.size());
+        for(auto& interface : snapshot->interfaces)
+        {
             if(interface->isOpen()) interfaces.push_back(interface);
         }
     }
@@ -102,78 +128,103 @@ std::vector<std::shared_ptr<Ccu>> Interfaces::getInterfaces()
 
 std::shared_ptr<Ccu> Interfaces::getDefaultInterface()
 {
-    std::lock_guard<std::mutex> interfaceGuard(_physicalInterfacesMutex);
-    return _defaultPhysicalInterface;
+    return getSnapshot()->defaultInterface;
 }
 
 std::shared_ptr<Ccu> Interfaces::getInterface(std::string& name)
 {
-    std::lock_guard<std::mutex> interfaceGuard(_physicalInterfacesMutex);
-    auto interfaceBase = _physicalInterfaces.find(name);
-    if(interfaceBase == _physicalInterfaces.end()) return std::shared_ptr<Ccu>();
-    std::shared_ptr<Ccu> interface(std::dynamic_pointer_cast<Ccu>(interfaceBase->second));
-    return interface;
+    auto snapshot = getSnapshot();
+    auto interfaceIterator = snapshot->interfacesById.find(name);
+    if(interfaceIterator == snapshot->interfacesById.end()) return std::shared_ptr<Ccu>();
+    return interfaceIterator->second;
 }
 
 std::shared_ptr<Ccu> Interfaces::getInterfaceByIp(std::string& ipAddress)
 {
-    std::lock_guard<std::mutex> interfaceGuard(_physicalInterfacesMutex);
-    for(auto& interfaceBase : _physicalInterfaces)
-    {
-        std::shared_ptr<Ccu> interface(std::dynamic_pointer_cast<Ccu>(interfaceBase.second));
-        if(!interface) continue;
-        if(interface->getHostname() == ipAddress) return interface;
-    }
-    return std::shared_ptr<Ccu>();
+    auto snapshot = getSnapshot();
+    auto interfaceIterator = snapshot->interfacesByIp.find(ipAddress);
+    if(interfaceIterator == snapshot->interfacesByIp.end()) return std::shared_ptr<Ccu>();
+    return interfaceIterator->second;
 }
 
 std::shared_ptr<Ccu> Interfaces::getInterfaceBySerial(std::string& serial)
 {
-    std::lock_guard<std::mutex> interfaceGuard(_physicalInterfacesMutex);
-    for(auto& interfaceBase : _physicalInterfaces)
-    {
-        std::shared_ptr<Ccu> interface(std::dynamic_pointer_cast<Ccu>(interfaceBase.second));
-        if(!interface) continue;
-        if(interface->getSerialNumber() == serial) return interface;
-    }
-    return std::shared_ptr<Ccu>();
+    auto snapshot = getSnapshot();
+    auto interfaceIterator = snapshot->interfacesBySerial.find(serial);
+    if(interfaceIterator == snapshot->interfacesBySerial.end()) return std::shared_ptr<Ccu>();
+    return interfaceIterator->second;
 }
 
 void Interfaces::removeUnknownInterfaces(std::set<std::string>& knownInterfaces)
 {
     try
     {
-        std::vector<std::string> interfacesToDelete;
-        std::lock_guard<std::mutex> interfaceGuard(_physicalInterfacesMutex);
-        for(auto& interfaceBase : _physicalInterfaces)
+        SettingsBatch settingsBatch;
         {
-            std::shared_ptr<Ccu> interface(std::dynamic_pointer_cast<Ccu>(interfaceBase.second));
-            if(!interface) continue;
-            if((interface->getType() != "ccu2-auto" && interface->getType() != "ccu-auto") || knownInterfaces.find(interfaceBase.first) != knownInterfaces.end() || interface->isOpen()) continue;
+            std::vector<std::string> interfacesToDelete;
+            std::lock_guard<std::mutex> interfaceGuard(_physicalInterfacesMutex);
+            for(auto& interfaceBase : _physicalInterfaces)
             {
-                GD::out.printInfo("Removing CCU with serial number " + interfaceBase.first + " and IP address " + interface->getHostname() + ".");
-                std::string name = interfaceBase.first + ".devicetype";
-                GD::family->deleteFamilySettingFromDatabase(name);
-                name = interfaceBase.first + ".host";
-                GD::family->deleteFamilySettingFromDatabase(name);
-                name = interfaceBase.first + ".serialnumber";
-                GD::family->deleteFamilySettingFromDatabase(name);
-                name = interfaceBase.first + ".port";
-                GD::family->deleteFamilySettingFromDatabase(name);
-                name = interfaceBase.first + ".port2";
-                GD::family->deleteFamilySettingFromDatabase(name);
-                name = interfaceBase.first + ".port3";
-                GD::family->deleteFamilySettingFromDatabase(name);
-                name = interfaceBase.first + ".port4";
-                GD::family->deleteFamilySettingFromDatabase(name);
-
+                std::shared_ptr<Ccu> interface(std::dynamic_pointer_cast<Ccu>(interfaceBase.second));
+                if(!interface) continue;
+                if((interface->getType() != "ccu2-auto" && interface->getType() != "ccu-auto") || knownInterfaces.find(interfaceBase.first) != knownInterfaces.end() || interface->isOpen()) continue;
+                GD::out.printInfo("Removing CCU with serial number " + interfaceBase.first + " and IP address " + interface->getHost() + ".");
+                addInterfaceSettingDeletions(settingsBatch, interfaceBase.first);
                 interfacesToDelete.push_back(interfaceBase.first);
             }
+
+            for(auto& interface : interfacesToDelete)
+            {
+                _physicalInterfaces.erase(interface);
+            }
+            if(!interfacesToDelete.empty()) publishSnapshot();
         }
 
-        for(auto& interface : interfacesToDelete)
+        writeSettingsSerialized(settingsBatch);
+    }
+    catch(const std::exception& ex)
+    {
+        GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+    }
+}
+
+void Interfaces::addInterfaceSettings(SettingsBatch& batch, const Systems::PPhysicalInterfaceSettings& settings)
+{
+    batch.values.reserve(batch.values.size() + 7);
+    batch.values.emplace_back(settings->id + ".devicetype", settings->type);
+    batch.values.emplace_back(settings->id + ".host", settings->host);
+    batch.values.emplace_back(settings->id + ".serialnumber", settings->serialNumber);
+    batch.values.emplace_back(settings->id + ".port", settings->port);
+    batch.values.emplace_back(settings->id + ".port2", settings->port2);
+    batch.values.emplace_back(settings->id + ".port3", settings->port3);
+    batch.values.emplace_back(settings->id + ".port4", settings->port4);
+}
+
+void Interfaces::addInterfaceSettingDeletions(SettingsBatch& batch, const std::string& id)
+{
+    for(auto& suffix : {".devicetype", ".host", ".serialnumber", ".port", ".port2", ".port3", ".port4"})
+    {
+        batch.deletions.push_back(id + suffix);
+    }
+}
+
+void Interfaces::writeSettingsSerialized(const SettingsBatch& batch)
+{
+    try
+    {
+        if(batch.values.empty() && batch.deletions.empty()) return;
+        std::lock_guard<std::mutex> settingsWriteGuard(_settingsWriteMutex);
+        for(auto& name : batch.deletions)
+        {
+            std::string settingName = name;
+            GD::family->deleteFamilySettingFromDatabase(settingName);
+        }
+        for(auto& value : batch.values)
         {
-            _physicalInterfaces.erase(interface);
+            std::string settingName = value.first;
+            auto setting = GD::family->getFamilySetting(settingName);
+            if(setting && setting->stringValue == value.second) continue;
+            GD::family->setFamilySetting(settingName, value.second);
         }
     }
     catch(const std::exception& ex)
@@ -182,11 +233,33 @@ void Interfaces::removeUnknownInterfaces(std::set<std::string>& knownInterfaces)
     }
 }
 
+bool Interfaces::setInterfaceHost(std::shared_ptr<Ccu>& interface, const std::string& host)
+{
+    try
+    {
+        if(!interface || !interface->setHost(host)) return false;
+        {
+            std::lock_guard<std::mutex> interfaceGuard(_physicalInterfacesMutex);
+            publishSnapshot();
+        }
+        SettingsBatch settingsBatch;
+        settingsBatch.values.emplace_back(interface->getID() + ".host", host);
+        writeSettingsSerialized(settingsBatch);
+        return true;
+    }
+    catch(const std::exception& ex)
+    {
+        GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+    }
+    return false;
+}
+
 std::shared_ptr<Ccu> Interfaces::addInterface(Systems::PPhysicalInterfaceSettings settings, bool storeInDatabase)
 {
     try
     {
         std::shared_ptr<Ccu> device;
+        SettingsBatch settingsBatch;
         if(!settings || settings->type.empty()) return device;
         GD::out.printDebug("Debug: Creating physical device. Type is: " + settings->type);
 
@@ -200,24 +273,10 @@ std::shared_ptr<Ccu> Interfaces::addInterface(Systems::PPhysicalInterfaceSetting
             std::lock_guard<std::mutex> interfaceGuard(_physicalInterfacesMutex);
             _physicalInterfaces[settings->id] = device;
             if(settings->isDefault || !_defaultPhysicalInterface || _defaultPhysicalInterface->getType() == "ccu-temp" || _defaultPhysicalInterface->getType() == "ccu2-temp") _defaultPhysicalInterface = device;
-            if(storeInDatabase)
-            {
-                std::string name = settings->id + ".devicetype";
-                GD::family->setFamilySetting(name, settings->type);
-                name = settings->id + ".host";
-                GD::family->setFamilySetting(name, settings->host);
-                name = settings->id + ".serialnumber";
-                GD::family->setFamilySetting(name, settings->serialNumber);
-                name = settings->id + ".port";
-                GD::family->setFamilySetting(name, settings->port);
-                name = settings->id + ".port2";
-                GD::family->setFamilySetting(name, settings->port2);
-                name = settings->id + ".port3";
-                GD::family->setFamilySetting(name, settings->port3);
-                name = settings->id + ".port4";
-                GD::family->setFamilySetting(name, settings->port4);
-            }
+            publishSnapshot();
+            if(storeInDatabase) addInterfaceSettings(settingsBatch, settings);
         }
+        writeSettingsSerialized(settingsBatch);
         return device;
     }
     catch(const std::exception& ex)
@@ -240,7 +299,9 @@ void Interfaces::create()
         {
             Systems::PPhysicalInterfaceSettings settings = std::make_shared<Systems::PhysicalInterfaceSettings>();
             settings->type = "ccu-temp";
+            std::lock_guard<std::mutex> interfaceGuard(_physicalInterfacesMutex);
             _defaultPhysicalInterface = std::make_shared<Ccu>(settings);
+            publishSnapshot();
         }
     }
     catch(const std::exception& ex)
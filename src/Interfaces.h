@@ -48,16 +48,70 @@ public:
     void removeEventHandlers();
     std::shared_ptr<Ccu> addInterface(Systems::PPhysicalInterfaceSettings settings, bool storeInDatabase);
     void removeUnknownInterfaces(std::set<std::string>& knownInterfaces);
+
+    /**
+     * Changes the host of a running interface in place and stores the new host in the database.
+     */
+    bool setInterfaceHost(std::shared_ptr<Ccu>& interface, const std::string& host);
     std::shared_ptr<Ccu> getDefaultInterface();
     std::shared_ptr<Ccu> getInterface(std::string& name);
     std::shared_ptr<Ccu> getInterfaceByIp(std::string& ipAddress);
 	std::shared_ptr<Ccu> getInterfaceBySerial(std::string& serial);
     std::vector<std::shared_ptr<Ccu>> getInterfaces();
+
+    /**
+     * Returns a number that changes whenever an interface is added, removed or changes its host. Holders of an interface pointer can compare it to
+     * the number they got the pointer with to check if it is still current.
+     */
+    uint64_t getGeneration() { return _generation.load(std::memory_order_acquire); }
 protected:
+    /**
+     * Immutable view of all interfaces. A new snapshot is published on every change, so readers don't need to lock.
+     */
+    struct InterfacesSnapshot
+    {
+        uint64_t generation = 0;
+        std::shared_ptr<Ccu> defaultInterface;
+        std::vector<std::shared_ptr<Ccu>> interfaces;
+        std::unordered_map<std::string, std::shared_ptr<Ccu>> interfacesById;
+        std::unordered_map<std::string, std::shared_ptr<Ccu>> interfacesBySerial;
+        std::unordered_map<std::string, std::shared_ptr<Ccu>> interfacesByIp;
+    };
+
+    /**
+     * Family setting changes collected while "_physicalInterfacesMutex" is locked and written after it was released.
+     */
+    struct SettingsBatch
+    {
+        std::vector<std::pair<std::string, std::string>> values;
+        std::vector<std::string> deletions;
+    };
+
     std::shared_ptr<Ccu> _defaultPhysicalInterface;
     std::map<std::string, PEventHandler> _physicalInterfaceEventhandlers;
+    std::mutex _settingsWriteMutex;
+    std::atomic<uint64_t> _generation{0};
+    std::shared_ptr<const InterfacesSnapshot> _snapshot = std::make_shared<const InterfacesSnapshot>();
 
 	virtual void create();
+
+    /**
+     * Creates a new snapshot from "_physicalInterfaces". "_physicalInterfacesMutex" must be locked.
+     */
+    void publishSnapshot();
+    std::shared_ptr<const InterfacesSnapshot> getSnapshot() { return std::atomic_load(&_snapshot); }
+
+    void addInterfaceSettings(SettingsBatch& batch, const Systems::PPhysicalInterfaceSettings& settings);
+    void addInterfaceSettingDeletions(SettingsBatch& batch, const std::string& id);
+
+    /**
+     * Writes all settings of a batch. Batches are written one after another, so the settings of an interface are never mixed with those of a concurrent
+     * write. Values that are already stored are skipped.
+     *
+     * This is not atomic: Every setting is a separate database write, because BaseLib reads the interface settings one by one on startup. If Homegear
+     * stops in the middle of a batch, only part of it is stored.
+     */
+    void writeSettingsSerialized(const SettingsBatch& batch);
 };
 
 }
@@ -30,6 +30,7 @@
 #include "MyCentral.h"
 #include "GD.h"
 
+#include <future>
 #include <iomanip>
 #include <arpa/inet.h>
 
@@ -63,6 +64,19 @@ void MyCentral::dispose(bool wait) {
       _bl->threadManager.join(_searchDevicesThread);
     }
 
+    {
+      //"onPacketReceived" doesn't start the thread anymore once "_disposing" is set. The join must not hold the mutex, as the thread needs it to finish.
+      std::lock_guard<std::mutex> resyncGuard(_resyncThreadMutex);
+    }
+    _bl->threadManager.join(_resyncThread);
+
+    {
+      std::lock_guard<std::mutex> descriptionUpdateGuard(_descriptionUpdateThreadMutex);
+    }
+    _bl->threadManager.join(_descriptionUpdateThread);
+
+    if (_discovery) _discovery->stop();
+
     GD::out.printDebug("Removing device " + std::to_string(_deviceId) + " from physical device's event queue...");
     GD::interfaces->removeEventHandlers();
 
@@ -84,6 +98,9 @@ void MyCentral::init() {
 
     GD::interfaces->addEventHandlers((BaseLib::Systems::IPhysicalInterface::IPhysicalInterfaceEventSink *)this);
 
+    _discovery.reset(new CcuDiscovery(std::bind(&MyCentral::discoveryResult, this, std::placeholders::_1)));
+    if (!_discovery->start()) GD::out.printError("Error: Could not start CCU discovery.");
+
     GD::bl->threadManager.start(_workerThread, true, _bl->settings.workerThreadPriority(), _bl->settings.workerThreadPolicy(), &MyCentral::worker, this);
   }
   catch (const std::exception &ex) {
@@ -104,11 +121,11 @@ void MyCentral::worker() {
     std::chrono::milliseconds sleepingTime(1000);
     uint32_t counter = 0;
     uint32_t countsPer10Minutes = BaseLib::HelperFunctions::getRandomNumber(10, 600);
+    bool searched = false;
     //uint64_t lastPeer;
     //lastPeer = 0;
 
-    BaseLib::PVariable metadata = std::make_shared<BaseLib::Variable>(BaseLib::VariableType::tStruct);
-    metadata->structValue->emplace("addNewInterfaces", std::make_shared<BaseLib::Variable>(false));
+    hydrateValues();
 
     while (!_stopWorkerThread && !_shuttingDown) {
       try {
@@ -118,7 +135,18 @@ void MyCentral::worker() {
         if (counter >= countsPer10Minutes) {
           countsPer10Minutes = 600;
           counter = 0;
-          searchInterfaces(nullptr, metadata);
+          //CCUs announce IP changes themselves. Only keep searching when the announcements can't be received.
+          if (!searched || !_discovery || !_discovery->receivingAnnouncements()) startInterfaceSearch();
+          searched = true;
+        }
+        processCoalescedEvents();
+        if (counter % 60 == 0) {
+          hydrateValues();
+          if (_reportValueUsage) {
+            for (auto &interface : GD::interfaces->getInterfaces()) {
+              if (interface->hasHmip()) reportValueUsage(interface->getID(), false);
+            }
+          }
         }
         /*if(counter % 60 == 0) //Once per minute
         {
@@ -154,23 +182,150 @@ void MyCentral::worker() {
 
 void MyCentral::loadPeers() {
   try {
+    std::string settingName = "autoAddDevices";
+    auto setting = GD::family->getFamilySetting(settingName);
+    std::string autoAddDevices = setting ? setting->stringValue : "";
+    _autoAddDevices = (setting && setting->integerValue == 1) || BaseLib::HelperFunctions::toLower(autoAddDevices) == "true";
+    settingName = "suppressUnchangedValues";
+    setting = GD::family->getFamilySetting(settingName);
+    std::string suppressUnchangedValues = setting ? setting->stringValue : "";
+    if ((setting && setting->integerValue == 1) || BaseLib::HelperFunctions::toLower(suppressUnchangedValues) == "true") {
+      auto unchangedValueSuppression = std::make_shared<MyPeer::UnchangedValueSuppression>();
+      unchangedValueSuppression->maxSilence = 3600000;
+      settingName = "unchangedValueMaxSilence";
+      setting = GD::family->getFamilySetting(settingName);
+      if (setting && setting->integerValue > 0) unchangedValueSuppression->maxSilence = (int64_t)setting->integerValue * 1000;
+      settingName = "unchangedValueMaxSilenceByParameter";
+      setting = GD::family->getFamilySetting(settingName);
+      if (setting) {
+        //Format: "PARAMETER:SECONDS, PARAMETER:SECONDS"
+        auto entries = BaseLib::HelperFunctions::splitAll(setting->stringValue, ',');
+        for (auto &entry : entries) {
+          auto pair = BaseLib::HelperFunctions::splitLast(entry, ':');
+          BaseLib::HelperFunctions::trim(pair.first);
+          BaseLib::HelperFunctions::trim(pair.second);
+          if (pair.first.empty() || pair.second.empty()) continue;
+          unchangedValueSuppression->maxSilenceByParameter[pair.first] = (int64_t)BaseLib::Math::getNumber(pair.second) * 1000;
+        }
+      }
+      _unchangedValueSuppression = unchangedValueSuppression;
+      GD::out.printInfo("Info: Events of unchanged values are suppressed for up to " + std::to_string(unchangedValueSuppression->maxSilence / 1000) + " seconds.");
+    }
+    settingName = "eventRateLimit";
+    setting = GD::family->getFamilySetting(settingName);
+    if (setting && !setting->stringValue.empty()) {
+      //Format: "RATE:BURST"
+      auto pair = BaseLib::HelperFunctions::splitFirst(setting->stringValue, ':');
+      auto eventRateLimit = std::make_shared<MyPeer::EventRateLimit>();
+      eventRateLimit->rate = BaseLib::Math::getDouble(BaseLib::HelperFunctions::trim(pair.first));
+      eventRateLimit->burst = pair.second.empty() ? eventRateLimit->rate : BaseLib::Math::getDouble(BaseLib::HelperFunctions::trim(pair.second));
+      if (eventRateLimit->rate > 0 && eventRateLimit->burst >= 1) _defaultEventRateLimit = eventRateLimit;
+    }
+    settingName = "eventRateLimitByType";
+    setting = GD::family->getFamilySetting(settingName);
+    if (setting) {
+      //Format: "DEVICE_TYPE:RATE:BURST, DEVICE_TYPE:RATE:BURST". A rate of 0 disables the limit for a device type.
+      auto entries = BaseLib::HelperFunctions::splitAll(setting->stringValue, ',');
+      for (auto &entry : entries) {
+        auto fields = BaseLib::HelperFunctions::splitAll(entry, ':');
+        if (fields.size() < 2) continue;
+        BaseLib::HelperFunctions::trim(fields.at(0));
+        if (fields.at(0).empty()) continue;
+        auto eventRateLimit = std::make_shared<MyPeer::EventRateLimit>();
+        eventRateLimit->rate = BaseLib::Math::getDouble(BaseLib::HelperFunctions::trim(fields.at(1)));
+        eventRateLimit->burst = fields.size() < 3 ? eventRateLimit->rate : BaseLib::Math::getDouble(BaseLib::HelperFunctions::trim(fields.at(2)));
+        _eventRateLimitsByType[fields.at(0)] = eventRateLimit->rate > 0 && eventRateLimit->burst >= 1 ? eventRateLimit : std::shared_ptr<MyPeer::EventRateLimit>();
+      }
+    }
+
+    settingName = "reportValueUsage";
+    setting = GD::family->getFamilySetting(settingName);
+    std::string reportValueUsage = setting ? setting->stringValue : "";
+    _reportValueUsage = (setting && setting->integerValue == 1) || BaseLib::HelperFunctions::toLower(reportValueUsage) == "true";
+    settingName = "valueUsage";
+    setting = GD::family->getFamilySetting(settingName);
+    if (setting) {
+      //Format: "PARAMETER:0, PARAMETER:1"
+      auto entries = BaseLib::HelperFunctions::splitAll(setting->stringValue, ',');
+      for (auto &entry : entries) {
+        auto pair = BaseLib::HelperFunctions::splitLast(entry, ':');
+        BaseLib::HelperFunctions::trim(pair.first);
+        BaseLib::HelperFunctions::trim(pair.second);
+        if (pair.first.empty() || pair.second.empty()) continue;
+        _valueUsagePolicy[pair.first] = pair.second != "0" && BaseLib::HelperFunctions::toLower(pair.second) != "false";
+      }
+    }
+    if (_reportValueUsage && _valueUsagePolicy.empty()) {
+      //This module can't see which values scripts or flows use, so without a policy there is nothing to report.
+      GD::out.printWarning("Warning: \"reportValueUsage\" is enabled, but \"valueUsage\" is not set. Value usage is not reported.");
+      _reportValueUsage = false;
+    }
+    settingName = "valueUsageBatchSize";
+    setting = GD::family->getFamilySetting(settingName);
+    if (setting && setting->integerValue > 0) _valueUsageBatchSize = setting->integerValue;
+    settingName = "peerLoadThreads";
+    setting = GD::family->getFamilySetting(settingName);
+    if (setting && setting->integerValue > 0) _maxPeerLoadThreads = setting->integerValue;
+    settingName = "minPeersPerLoadThread";
+    setting = GD::family->getFamilySetting(settingName);
+    if (setting && setting->integerValue > 0) _minPeersPerLoadThread = setting->integerValue;
+
     std::shared_ptr<BaseLib::Database::DataTable> rows = _bl->db->getPeers(_deviceId);
-    for (BaseLib::Database::DataTable::iterator row = rows->begin(); row != rows->end(); ++row) {
-      int32_t peerID = row->second.at(0)->intValue;
-      GD::out.printMessage("Loading CCU peer " + std::to_string(peerID));
-      std::shared_ptr<MyPeer> peer(new MyPeer(peerID, row->second.at(2)->intValue, row->second.at(3)->textValue, _deviceId, this));
-      if (!peer->load(this)) continue;
-      if (!peer->getRpcDevice()) continue;
-      std::lock_guard<std::mutex> peersGuard(_peersMutex);
+    std::vector<BaseLib::Database::DataRow *> peerRows;
+    peerRows.reserve(rows->size());
+    for (auto &row : *rows) {
+      peerRows.push_back(&row.second);
+    }
+
+    //Every peer needs several database queries. Load them in parallel and register all peers at once when done, so nobody sees a half loaded set.
+    uint32_t threadCount = std::max(1u, std::min(_maxPeerLoadThreads, std::thread::hardware_concurrency()));
+    threadCount = std::max((size_t)1, std::min((size_t)threadCount, peerRows.size() / _minPeersPerLoadThread));
+    std::atomic<size_t> nextRow{0};
+    std::mutex loadedPeersMutex;
+    std::vector<std::shared_ptr<MyPeer>> loadedPeers;
+    loadedPeers.reserve(peerRows.size());
+
+    std::vector<std::thread> threads(threadCount - 1);
+    for (auto &thread : threads) {
+      _bl->threadManager.start(thread, false, &MyCentral::loadPeersThread, this, std::ref(peerRows), std::ref(nextRow), std::ref(loadedPeersMutex), std::ref(loadedPeers));
+    }
+    loadPeersThread(peerRows, nextRow, loadedPeersMutex, loadedPeers);
+    for (auto &thread : threads) {
+      _bl->threadManager.join(thread);
+    }
+
+    std::lock_guard<std::mutex> peersGuard(_peersMutex);
+    for (auto &peer : loadedPeers) {
       if (!peer->getSerialNumber().empty()) _peersBySerial[peer->getSerialNumber()] = peer;
-      _peersById[peerID] = peer;
+      _peersById[peer->getID()] = peer;
     }
+    GD::out.printInfo("Info: Loaded " + std::to_string(loadedPeers.size()) + " CCU peers using " + std::to_string(threadCount) + " threads.");
   }
   catch (const std::exception &ex) {
     GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
   }
 }
 
+void MyCentral::loadPeersThread(std::vector<BaseLib::Database::DataRow *> &rows, std::atomic<size_t> &nextRow, std::mutex &loadedPeersMutex, std::vector<std::shared_ptr<MyPeer>> &loadedPeers) {
+  for (size_t i = nextRow++; i < rows.size(); i = nextRow++) {
+    try {
+      auto &row = *rows.at(i);
+      int32_t peerID = row.at(0)->intValue;
+      GD::out.printMessage("Loading CCU peer " + std::to_string(peerID));
+      std::shared_ptr<MyPeer> peer(new MyPeer(peerID, row.at(2)->intValue, row.at(3)->textValue, _deviceId, this));
+      peer->setUnchangedValueSuppression(_unchangedValueSuppression);
+      if (!peer->load(this)) continue;
+      if (!peer->getRpcDevice()) continue;
+      peer->setEventRateLimit(getEventRateLimit(peer));
+      std::lock_guard<std::mutex> loadedPeersGuard(loadedPeersMutex);
+      loadedPeers.push_back(peer);
+    }
+    catch (const std::exception &ex) {
+      GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+    }
+  }
+}
+
 std::shared_ptr<MyPeer> MyCentral::getPeer(uint64_t id) {
   try {
     std::lock_guard<std::mutex> peersGuard(_peersMutex);
@@ -208,13 +363,22 @@ bool MyCentral::onPacketReceived(std::string &senderId, std::shared_ptr<BaseLib:
     if (_bl->debugLevel >= 4) _bl->out.printInfo(BaseLib::HelperFunctions::getTimeString(myPacket->getTimeReceived()) + " Packet received (" + senderId + "): Method name: " + myPacket->getMethodName());
 
     if (myPacket->getMethodName() == "newDevices") {
-      if (_pairing) {
+      if (_pairing || _autoAddDevices) {
         auto parameters = myPacket->getParameters();
         if (parameters->size() < 2) return false;
 
         auto interface = GD::interfaces->getInterface(senderId);
         if (!interface) return false;
-        auto deviceNames = interface->getNames();
+
+        std::vector<std::string> serialNumbers;
+        for (auto &description : *parameters->at(1)->arrayValue) {
+          auto addressIterator = description->structValue->find("ADDRESS");
+          if (addressIterator == description->structValue->end() || addressIterator->second->stringValue.find(':') != std::string::npos) continue;
+          serialNumbers.push_back(addressIterator->second->stringValue);
+        }
+        //Pairing usually adds single devices. Query their names directly instead of loading the names of all devices.
+        std::shared_ptr<const Ccu::DeviceNames> deviceNames;
+        if (serialNumbers.size() > 5) deviceNames = interface->getNames();
 
         for (auto &description : *parameters->at(1)->arrayValue) {
           auto addressIterator = description->structValue->find("ADDRESS");
@@ -223,13 +387,151 @@ bool MyCentral::onPacketReceived(std::string &senderId, std::shared_ptr<BaseLib:
           BaseLib::HelperFunctions::stripNonAlphaNumeric(serialNumber);
           if (serialNumber.find(':') != std::string::npos) continue;
           std::unordered_map<int32_t, std::string> names;
-          auto deviceNameIterator = deviceNames.find(serialNumber);
-          if (deviceNameIterator != deviceNames.end()) names = deviceNameIterator->second;
-          pairDevice((Ccu::RpcType)parameters->at(0)->integerValue, senderId, serialNumber, names);
+          if (deviceNames) {
+            auto deviceNameIterator = deviceNames->find(serialNumber);
+            if (deviceNameIterator != deviceNames->end()) names = deviceNameIterator->second;
+          } else names = interface->getNames(serialNumber);
+          auto versionIterator = description->structValue->find("VERSION");
+          auto peer = getPeer(serialNumber);
+          if (peer && peer->getPhysicalInterfaceId() == senderId && peer->getRpcType() == (Ccu::RpcType)parameters->at(0)->integerValue) {
+            //Known devices are only updated. "pairDevice" would create the description a second time.
+            for (auto &name : names) {
+              if (peer->getName(name.first).empty()) peer->setName(name.first, name.second);
+            }
+            peer.reset();
+            queueDescriptionUpdate((Ccu::RpcType)parameters->at(0)->integerValue, senderId, serialNumber, description);
+            continue;
+          }
+          peer.reset();
+          pairDevice((Ccu::RpcType)parameters->at(0)->integerValue, senderId, serialNumber, names, versionIterator == description->structValue->end() ? -1 : versionIterator->second->integerValue);
         }
+        removeUnpairedDevices((Ccu::RpcType)parameters->at(0)->integerValue, senderId, parameters->at(1));
+        return true;
+      } else {
+        //The CCU also calls "newDevices" for known devices, e. g. after firmware updates.
+        auto parameters = myPacket->getParameters();
+        if (parameters->size() < 2) return false;
+
+        for (auto &description : *parameters->at(1)->arrayValue) {
+          auto addressIterator = description->structValue->find("ADDRESS");
+          if (addressIterator == description->structValue->end()) continue;
+          std::string serialNumber = addressIterator->second->stringValue;
+          BaseLib::HelperFunctions::stripNonAlphaNumeric(serialNumber);
+          if (serialNumber.find(':') != std::string::npos) continue;
+          queueDescriptionUpdate((Ccu::RpcType)parameters->at(0)->integerValue, senderId, serialNumber, description);
+        }
+        removeUnpairedDevices((Ccu::RpcType)parameters->at(0)->integerValue, senderId, parameters->at(1));
         return true;
       }
-      return false;
+    }
+
+    if (myPacket->getMethodName() == "updateDevice") {
+      auto parameters = myPacket->getParameters();
+      if (parameters->size() < 3) return false;
+
+      //Hint 0 means the description changed, 1 that the links changed. Links are always read from the CCU, so there is nothing to do for hint 1.
+      if (parameters->at(2)->integerValue != 0) return true;
+      std::string serialNumber = BaseLib::HelperFunctions::splitFirst(parameters->at(1)->stringValue, ':').first;
+      BaseLib::HelperFunctions::stripNonAlphaNumeric(serialNumber);
+      queueDescriptionUpdate((Ccu::RpcType)parameters->at(0)->integerValue, senderId, serialNumber, PVariable());
+      return true;
+    }
+
+    if (myPacket->getMethodName() == "deleteDevices") {
+      auto parameters = myPacket->getParameters();
+      if (parameters->size() < 2) return false;
+
+      for (auto &address : *parameters->at(1)->arrayValue) {
+        std::string serialNumber = address->stringValue;
+        BaseLib::HelperFunctions::stripNonAlphaNumeric(serialNumber);
+        if (serialNumber.find(':') != std::string::npos) continue;
+        auto peer = getPeer(serialNumber);
+        if (!peer || peer->getPhysicalInterfaceId() != senderId || peer->getRpcType() != (Ccu::RpcType)parameters->at(0)->integerValue) continue;
+        uint64_t peerId = peer->getID();
+        peer.reset();
+        GD::out.printInfo("Info: Device " + serialNumber + " was deleted on CCU " + senderId + ".");
+        deletePeer(peerId);
+      }
+      return true;
+    }
+
+    if (myPacket->getMethodName() == "replaceDevice") {
+      auto parameters = myPacket->getParameters();
+      if (parameters->size() < 3) return false;
+
+      std::string oldSerialNumber = parameters->at(1)->stringValue;
+      BaseLib::HelperFunctions::stripNonAlphaNumeric(oldSerialNumber);
+      std::string newSerialNumber = parameters->at(2)->stringValue;
+      BaseLib::HelperFunctions::stripNonAlphaNumeric(newSerialNumber);
+      replaceDevice((Ccu::RpcType)parameters->at(0)->integerValue, senderId, oldSerialNumber, newSerialNumber);
+      return true;
+    }
+
+    if (myPacket->getMethodName() == "readdedDevice") {
+      auto parameters = myPacket->getParameters();
+      if (parameters->size() < 2) return false;
+
+      //The device was reset and taught-in again, so its description might have changed.
+      for (auto &address : *parameters->at(1)->arrayValue) {
+        std::string serialNumber = address->stringValue;
+        BaseLib::HelperFunctions::stripNonAlphaNumeric(serialNumber);
+        if (serialNumber.find(':') != std::string::npos) continue;
+        if (getPeer(serialNumber)) queueDescriptionUpdate((Ccu::RpcType)parameters->at(0)->integerValue, senderId, serialNumber, PVariable());
+        else if (_autoAddDevices) {
+          auto interface = GD::interfaces->getInterface(senderId);
+          if (!interface) continue;
+          auto names = interface->getNames(serialNumber);
+          pairDevice((Ccu::RpcType)parameters->at(0)->integerValue, senderId, serialNumber, names);
+        }
+      }
+      return true;
+    }
+
+    if (myPacket->getMethodName() == "homegear.resyncValues") {
+      auto parameters = myPacket->getParameters();
+      if (parameters->empty()) return false;
+
+      std::lock_guard<std::mutex> resyncGuard(_resyncThreadMutex);
+      if (_disposing) return true;
+      _resyncRequests.emplace(senderId, (Ccu::RpcType)parameters->at(0)->integerValue);
+      if (!_resyncing) {
+        //"_resyncing" is only reset after the thread's last use of the mutex, so joining here cannot block.
+        _resyncing = true;
+        _bl->threadManager.join(_resyncThread);
+        _bl->threadManager.start(_resyncThread, true, &MyCentral::resyncThread, this);
+      }
+      return true;
+    }
+
+    if (myPacket->getMethodName() == "homegear.systemVariables") {
+      auto parameters = myPacket->getParameters();
+      if (parameters->size() < 3) return false;
+      auto interface = GD::interfaces->getInterface(senderId);
+      if (!interface) return false;
+
+      std::string serialNumber = interface->getSystemVariablesSerialNumber();
+      if (!parameters->at(1)->structValue->empty()) {
+        std::unordered_map<int32_t, std::string> names{{-1, "CCU system variables"}};
+        pairDevice(Ccu::RpcType::rega, senderId, serialNumber, names, parameters->at(2)->integerValue, parameters->at(1));
+      }
+
+      PMyPeer peer = getPeer(serialNumber);
+      if (!peer || senderId != peer->getPhysicalInterfaceId()) return false;
+      if (!parameters->at(0)->structValue->empty()) peer->updateValues(1, parameters->at(0));
+      return true;
+    }
+
+    if (myPacket->getMethodName() == "homegear.serviceMessagesChanged") {
+      auto parameters = myPacket->getParameters();
+      if (parameters->empty()) return false;
+
+      for (auto &change : *parameters->at(0)->arrayValue) {
+        if (change->arrayValue->size() < 3) continue;
+        PMyPeer peer = getPeer(change->arrayValue->at(0)->stringValue);
+        if (!peer || senderId != peer->getPhysicalInterfaceId()) continue;
+        peer->serviceMessageChanged(change->arrayValue->at(1)->stringValue, change->arrayValue->at(2)->booleanValue);
+      }
+      return true;
     }
 
     if (myPacket->getMethodName() == "event") {
@@ -250,13 +552,22 @@ bool MyCentral::onPacketReceived(std::string &senderId, std::shared_ptr<BaseLib:
   return false;
 }
 
-void MyCentral::pairDevice(Ccu::RpcType rpcType, std::string &interfaceId, std::string &serialNumber, std::unordered_map<int32_t, std::string> &names) {
+void MyCentral::pairDevice(Ccu::RpcType rpcType, std::string &interfaceId, std::string &serialNumber, std::unordered_map<int32_t, std::string> &names, int32_t version, PVariable systemVariablesDescription) {
   try {
     std::lock_guard<std::mutex> pairGuard(_pairMutex);
-    GD::out.printInfo("Info: Adding device " + serialNumber + "...");
 
     bool newPeer = true;
     auto peer = getPeer(serialNumber);
+    if (peer && version != -1 && peer->getRpcDevice() && peer->getRpcDevice()->version == version && peer->getPhysicalInterfaceId() == interfaceId && peer->getRpcType() == rpcType) {
+      //Description is unchanged, so only update missing names.
+      for (auto &name : names) {
+        if (peer->getName(name.first).empty()) peer->setName(name.first, name.second);
+      }
+      return;
+    }
+
+    GD::out.printInfo("Info: Adding device " + serialNumber + "...");
+    bool peerInUse = false;
     std::unique_lock<std::mutex> lockGuard(_peersMutex);
     if (peer) {
       newPeer = false;
@@ -269,13 +580,18 @@ void MyCentral::pairDevice(Ccu::RpcType rpcType, std::string &interfaceId, std::
         std::this_thread::sleep_for(std::chrono::milliseconds(100));
         i++;
       }
-      if (i == 600) GD::out.printError("Error: Peer deletion took too long.");
+      if (i == 600) {
+        GD::out.printError("Error: Peer " + std::to_string(peer->getID()) + " is still in use. Its description is not updated.");
+        peerInUse = true;
+      }
     } else lockGuard.unlock();
 
-    auto knownTypeIds = GD::family->getRpcDevices()->getKnownTypeNumbers();
-    auto peerInfo = _descriptionCreator.createDescription(rpcType, interfaceId, serialNumber, peer ? peer->getDeviceType() : 0, knownTypeIds);
+    auto knownTypeIds = GD::family->getCcuDevices()->getAllTypeNumbers();
+    auto peerInfo = rpcType == Ccu::RpcType::rega ?
+                    _descriptionCreator.createSystemVariableDescription(serialNumber, version, systemVariablesDescription, peer ? peer->getDeviceType() : 0, knownTypeIds) :
+                    _descriptionCreator.createDescription(rpcType, interfaceId, serialNumber, peer ? peer->getDeviceType() : 0, knownTypeIds);
     if (peerInfo.serialNumber.empty()) return; //Error
-    GD::family->reloadRpcDevices();
+    GD::family->getCcuDevices()->setSource(peerInfo.type, peerInfo.source);
 
     if (!peer) {
       peer = createPeer(peerInfo.type, peerInfo.firmwareVersion, peerInfo.serialNumber, true);
@@ -292,11 +608,13 @@ void MyCentral::pairDevice(Ccu::RpcType rpcType, std::string &interfaceId, std::
         peer->setName(name.first, name.second);
       }
     } else {
-      peer->setRpcDevice(GD::family->getRpcDevices()->find(peerInfo.type, peerInfo.firmwareVersion, -1));
-      if (!peer->getRpcDevice()) {
+      //Migrates the stored parameters, e. g. creates the parameters of new system variables. Also raises "updateDevice".
+      auto rpcDevice = GD::family->getCcuDevices()->get(peerInfo.type, peerInfo.firmwareVersion);
+      if (!rpcDevice) {
         GD::out.printError("Error: RPC device could not be found anymore.");
         return;
       }
+      if (!peerInUse) peer->updateRpcDevice(rpcDevice);
       for (auto &name : names) {
         if (peer->getName(name.first).empty()) peer->setName(name.first, name.second);
       }
@@ -306,6 +624,7 @@ void MyCentral::pairDevice(Ccu::RpcType rpcType, std::string &interfaceId, std::
     _peersBySerial[peer->getSerialNumber()] = peer;
     _peersById[peer->getID()] = peer;
     lockGuard.unlock();
+    if (newPeer) clearServiceMessagesCache();
 
     if (newPeer) {
       GD::out.printInfo("Info: Device successfully added. Peer ID is: " + std::to_string(peer->getID()));
@@ -320,8 +639,6 @@ void MyCentral::pairDevice(Ccu::RpcType rpcType, std::string &interfaceId, std::
       raiseRPCNewDevices(newIds, deviceDescriptions);
     } else {
       GD::out.printInfo("Info: Peer " + std::to_string(peer->getID()) + " successfully updated.");
-
-      raiseRPCUpdateDevice(peer->getID(), 0, peer->getSerialNumber() + ":" + std::to_string(0), 0);
     }
   }
   catch (const std::exception &ex) {
@@ -366,9 +683,15 @@ void MyCentral::deletePeer(uint64_t id) {
       if (_peersById.find(id) != _peersById.end()) _peersById.erase(id);
     }
 
+    clearServiceMessagesCache();
+
     std::vector<uint64_t> deletedIds{id};
     raiseRPCDeleteDevices(deletedIds, deviceAddresses, deviceInfo);
 
+    //Otherwise the device stays in the device fingerprint and the CCU never announces it again, so it couldn't be added anymore.
+    auto interface = GD::interfaces->getInterface(peer->getPhysicalInterfaceId());
+    if (interface) interface->removeKnownDevices(peer->getRpcType(), deviceAddresses);
+
     int32_t i = 0;
     while (peer.use_count() > 1 && i < 600) {
       std::this_thread::sleep_for(std::chrono::milliseconds(100));
@@ -394,6 +717,7 @@ std::string MyCentral::handleCliCommand(std::string command) {
       stringStream << "List of commands:" << std::endl << std::endl;
       stringStream << "For more information about the individual command type: COMMAND help" << std::endl << std::endl;
       stringStream << "search              Searches and adds CCUs" << std::endl;
+      stringStream << "dutycycle (dc)      Shows the duty cycle of all CCUs" << std::endl;
       stringStream << "pairing on (pon)    Enables pairing mode" << std::endl;
       stringStream << "pairing off (pof)   Disables pairing mode" << std::endl;
       stringStream << "peers list (ls)     List all peers" << std::endl;
@@ -415,6 +739,26 @@ std::string MyCentral::handleCliCommand(std::string command) {
 
       stringStream << "Search completed." << std::endl;
       return stringStream.str();
+    } else if (BaseLib::HelperFunctions::checkCliCommand(command, "dutycycle", "dc", "", 0, arguments, showHelp)) {
+      if (showHelp) {
+        stringStream << "Description: This command shows the duty cycle and carrier sense levels of the BidCoS and HomeMatic IP radios of all CCUs." << std::endl;
+        stringStream << "Usage: dutycycle" << std::endl << std::endl;
+        return stringStream.str();
+      }
+
+      auto printLevel = [](int32_t level) { return level < 0 ? std::string("unknown") : std::to_string(level) + " %"; };
+      int64_t time = BaseLib::HelperFunctions::getTime();
+      for (auto &interface : GD::interfaces->getInterfaces()) {
+        stringStream << interface->getID() << ":" << std::endl;
+        for (auto rpcType : {Ccu::RpcType::bidcos, Ccu::RpcType::hmip}) {
+          auto dutyCycle = interface->getDutyCycle(rpcType);
+          stringStream << (rpcType == Ccu::RpcType::bidcos ? "  BidCoS: " : "  HomeMatic IP: ") << "duty cycle " << printLevel(dutyCycle.dutyCycle) << ", carrier sense " << printLevel(dutyCycle.carrierSense);
+          if (dutyCycle.time > 0) stringStream << " (updated " << ((time - dutyCycle.time) / 1000) << " s ago)";
+          stringStream << std::endl;
+        }
+        stringStream << "  Deferred calls: " << interface->getDeferredInvokeCount() << std::endl;
+      }
+      return stringStream.str();
     } else if (BaseLib::HelperFunctions::checkCliCommand(command, "peers search", "", "", 0, arguments, showHelp)) {
       if (showHelp) {
         stringStream << "Description: This command searches for new peers paired to the connected CCUs." << std::endl;
@@ -645,10 +989,12 @@ std::string MyCentral::handleCliCommand(std::string command) {
 std::shared_ptr<MyPeer> MyCentral::createPeer(uint32_t deviceType, int32_t firmwareVersion, std::string serialNumber, bool save) {
   try {
     std::shared_ptr<MyPeer> peer(new MyPeer(_deviceId, this));
+    peer->setUnchangedValueSuppression(_unchangedValueSuppression);
     peer->setDeviceType(deviceType);
     peer->setSerialNumber(serialNumber);
-    peer->setRpcDevice(GD::family->getRpcDevices()->find(deviceType, firmwareVersion, -1));
+    peer->setRpcDevice(GD::family->getCcuDevices()->get(deviceType, firmwareVersion));
     if (!peer->getRpcDevice()) return std::shared_ptr<MyPeer>();
+    peer->setEventRateLimit(getEventRateLimit(peer));
     if (save) peer->save(true, true, false); //Save and create peerID
     return peer;
   }
@@ -711,17 +1057,24 @@ PVariable MyCentral::getServiceMessages(PRpcClientInfo clientInfo, bool returnId
     auto serviceMessages = ICentral::getServiceMessages(clientInfo, returnId, language, checkAcls);
     if (serviceMessages->errorStruct) return serviceMessages;
 
+    std::lock_guard<std::mutex> serviceMessagesCacheGuard(_serviceMessagesCacheMutex);
     auto interfaces = GD::interfaces->getInterfaces();
     for (auto &interface : interfaces) {
       auto ccuServiceMessages = interface->getServiceMessages();
 
-      serviceMessages->arrayValue->reserve(serviceMessages->arrayValue->size() + ccuServiceMessages.size());
+      //The elements are only rebuilt when the CCU's snapshot changed.
+      auto &cacheEntry = _serviceMessagesCache[interface->getID()];
+      if (cacheEntry.snapshot != ccuServiceMessages) {
+        cacheEntry.snapshot = ccuServiceMessages;
+        cacheEntry.elementsWithId.clear();
+        cacheEntry.elements.clear();
+        cacheEntry.elementsWithId.reserve(ccuServiceMessages->size());
+        cacheEntry.elements.reserve(ccuServiceMessages->size());
 
-      for (auto &element : ccuServiceMessages) {
-        auto peer = getPeer(element->serial);
-        if (!peer) continue;
+        for (auto &element : *ccuServiceMessages) {
+          auto peer = getPeer(element->serial);
+          if (!peer) continue;
 
-        if (returnId) {
           auto newElement = std::make_shared<Variable>(VariableType::tStruct);
           newElement->structValue->emplace("TYPE", std::make_shared<Variable>(2));
           newElement->structValue->emplace("PEER_ID", std::make_shared<Variable>(peer->getID()));
@@ -731,16 +1084,19 @@ PVariable MyCentral::getServiceMessages(PRpcClientInfo clientInfo, bool returnId
           newElement->structValue->emplace("MESSAGE", std::make_shared<Variable>(element->message));
           newElement->structValue->emplace("PRIORITY", std::make_shared<Variable>((int32_t)BaseLib::ServiceMessagePriority::kWarning));
           newElement->structValue->emplace("VALUE", std::make_shared<Variable>(element->value));
-          serviceMessages->arrayValue->emplace_back(newElement);
-        } else {
-          auto newElement = std::make_shared<Variable>(VariableType::tArray);
+          cacheEntry.elementsWithId.emplace_back(newElement);
+
+          newElement = std::make_shared<Variable>(VariableType::tArray);
           newElement->arrayValue->reserve(3);
           newElement->arrayValue->push_back(std::make_shared<BaseLib::Variable>(element->serial + ":0"));
           newElement->arrayValue->push_back(std::make_shared<BaseLib::Variable>(element->message));
           newElement->arrayValue->push_back(std::make_shared<BaseLib::Variable>(element->value));
-          serviceMessages->arrayValue->emplace_back(newElement);
+          cacheEntry.elements.emplace_back(newElement);
         }
       }
+
+      auto &elements = returnId ? cacheEntry.elementsWithId : cacheEntry.elements;
+      serviceMessages->arrayValue->insert(serviceMessages->arrayValue->end(), elements.begin(), elements.end());
     }
 
     return serviceMessages;
@@ -751,6 +1107,209 @@ PVariable MyCentral::getServiceMessages(PRpcClientInfo clientInfo, bool returnId
   return Variable::createError(-32500, "Unknown application error.");
 }
 
+void MyCentral::clearServiceMessagesCache() {
+  std::lock_guard<std::mutex> serviceMessagesCacheGuard(_serviceMessagesCacheMutex);
+  _serviceMessagesCache.clear();
+}
+
+void MyCentral::updateDescription(Ccu::RpcType rpcType, std::string &interfaceId, std::string &serialNumber, const PVariable &deviceDescription) {
+  try {
+    auto peer = getPeer(serialNumber);
+    if (!peer || !peer->getRpcDevice() || peer->getPhysicalInterfaceId() != interfaceId || peer->getRpcType() != rpcType || rpcType == Ccu::RpcType::rega) return;
+
+    auto source = GD::family->getCcuDevices()->getSource(peer->getDeviceType());
+    if (source && deviceDescription) {
+      bool changed = false;
+      for (auto &element : {"FIRMWARE", "VERSION"}) {
+        auto descriptionIterator = deviceDescription->structValue->find(element);
+        if (descriptionIterator == deviceDescription->structValue->end()) continue;
+        auto sourceIterator = source->structValue->find(element);
+        if (sourceIterator == source->structValue->end() || *sourceIterator->second != *descriptionIterator->second) changed = true;
+      }
+      if (!changed) return;
+    }
+
+    if (!source) {
+      //Descriptions not created from a cached source have to be created from scratch.
+      std::unordered_map<int32_t, std::string> names;
+      peer.reset();
+      pairDevice(rpcType, interfaceId, serialNumber, names);
+      return;
+    }
+
+    std::lock_guard<std::mutex> pairGuard(_pairMutex);
+    GD::out.printInfo("Info: Updating description of device " + serialNumber + "...");
+    bool changed = false;
+    auto peerInfo = _descriptionCreator.updateDescription(rpcType, interfaceId, serialNumber, peer->getDeviceType(), source, changed);
+    if (peerInfo.serialNumber.empty()) return; //Error
+    if (!changed) {
+      GD::out.printInfo("Info: Description of device " + serialNumber + " is unchanged.");
+      return;
+    }
+
+    //The parameters are migrated in place, so no other thread may use the peer. Like in "pairDevice", it is unregistered until we hold the only reference.
+    std::unique_lock<std::mutex> lockGuard(_peersMutex);
+    _peersBySerial.erase(peer->getSerialNumber());
+    _peersById.erase(peer->getID());
+    lockGuard.unlock();
+
+    int32_t i = 0;
+    while (peer.use_count() > 1 && i < 600) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      i++;
+    }
+
+    if (i == 600) GD::out.printError("Error: Peer " + std::to_string(peer->getID()) + " is still in use. Its description is not updated.");
+    else {
+      GD::family->getCcuDevices()->setSource(peerInfo.type, peerInfo.source);
+      auto rpcDevice = GD::family->getCcuDevices()->get(peerInfo.type, peerInfo.firmwareVersion);
+      if (rpcDevice) peer->updateRpcDevice(rpcDevice);
+      else GD::out.printError("Error: Updated description of device " + serialNumber + " could not be created.");
+    }
+
+    lockGuard.lock();
+    _peersBySerial[peer->getSerialNumber()] = peer;
+    _peersById[peer->getID()] = peer;
+  }
+  catch (const std::exception &ex) {
+    GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+  }
+}
+
+void MyCentral::queueDescriptionUpdate(Ccu::RpcType rpcType, const std::string &interfaceId, const std::string &serialNumber, const PVariable &deviceDescription) {
+  try {
+    std::lock_guard<std::mutex> descriptionUpdateGuard(_descriptionUpdateThreadMutex);
+    if (_disposing) return;
+    _descriptionUpdates.push_back(DescriptionUpdate{rpcType, interfaceId, serialNumber, deviceDescription});
+    if (!_updatingDescriptions) {
+      //"_updatingDescriptions" is only reset after the thread's last use of the mutex, so joining here cannot block.
+      _updatingDescriptions = true;
+      _bl->threadManager.join(_descriptionUpdateThread);
+      _bl->threadManager.start(_descriptionUpdateThread, true, &MyCentral::descriptionUpdateThread, this);
+    }
+  }
+  catch (const std::exception &ex) {
+    GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+  }
+}
+
+void MyCentral::descriptionUpdateThread() {
+  try {
+    while (!_disposing && !_shuttingDown) {
+      DescriptionUpdate update;
+      {
+        std::lock_guard<std::mutex> descriptionUpdateGuard(_descriptionUpdateThreadMutex);
+        if (_descriptionUpdates.empty()) {
+          _updatingDescriptions = false;
+          return;
+        }
+        update = std::move(_descriptionUpdates.front());
+        _descriptionUpdates.pop_front();
+      }
+
+      updateDescription(update.rpcType, update.interfaceId, update.serialNumber, update.deviceDescription);
+    }
+  }
+  catch (const std::exception &ex) {
+    GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+  }
+  //"dispose" releases the mutex before joining this thread.
+  std::lock_guard<std::mutex> descriptionUpdateGuard(_descriptionUpdateThreadMutex);
+  _updatingDescriptions = false;
+}
+
+void MyCentral::removeUnpairedDevices(Ccu::RpcType rpcType, std::string &interfaceId, const PVariable &deviceDescriptions) {
+  try {
+    auto interface = GD::interfaces->getInterface(interfaceId);
+    if (!interface) return;
+
+    auto addresses = std::make_shared<BaseLib::Variable>(BaseLib::VariableType::tArray);
+    std::unordered_map<std::string, bool> paired;
+    for (auto &description : *deviceDescriptions->arrayValue) {
+      auto addressIterator = description->structValue->find("ADDRESS");
+      if (addressIterator == description->structValue->end()) continue;
+      //Channels are removed together with their device.
+      std::string serialNumber = BaseLib::HelperFunctions::splitFirst(addressIterator->second->stringValue, ':').first;
+      BaseLib::HelperFunctions::stripNonAlphaNumeric(serialNumber);
+      auto pairedIterator = paired.find(serialNumber);
+      if (pairedIterator == paired.end()) {
+        auto peer = getPeer(serialNumber);
+        pairedIterator = paired.emplace(serialNumber, peer && peer->getPhysicalInterfaceId() == interfaceId && peer->getRpcType() == rpcType).first;
+      }
+      if (!pairedIterator->second) addresses->arrayValue->push_back(std::make_shared<BaseLib::Variable>(addressIterator->second->stringValue));
+    }
+    if (addresses->arrayValue->empty()) return;
+
+    if (_bl->debugLevel >= 5) GD::out.printDebug("Debug: Removing " + std::to_string(addresses->arrayValue->size()) + " addresses without peer from the device fingerprint of CCU " + interfaceId + ".");
+    interface->removeKnownDevices(rpcType, addresses);
+  }
+  catch (const std::exception &ex) {
+    GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+  }
+}
+
+void MyCentral::replaceDevice(Ccu::RpcType rpcType, std::string &interfaceId, std::string &oldSerialNumber, std::string &newSerialNumber) {
+  try {
+    auto peer = getPeer(oldSerialNumber);
+    if (!peer || peer->getPhysicalInterfaceId() != interfaceId || peer->getRpcType() != rpcType || getPeer(newSerialNumber)) {
+      if (_autoAddDevices && !getPeer(newSerialNumber)) {
+        auto interface = GD::interfaces->getInterface(interfaceId);
+        if (!interface) return;
+        auto names = interface->getNames(newSerialNumber);
+        pairDevice(rpcType, interfaceId, newSerialNumber, names);
+      }
+      return;
+    }
+
+    GD::out.printInfo("Info: Device " + oldSerialNumber + " was replaced by " + newSerialNumber + " on CCU " + interfaceId + ".");
+    auto oldAddresses = std::make_shared<BaseLib::Variable>(BaseLib::VariableType::tArray);
+    auto deviceInfo = std::make_shared<BaseLib::Variable>(BaseLib::VariableType::tStruct);
+    auto channels = std::make_shared<BaseLib::Variable>(BaseLib::VariableType::tArray);
+    deviceInfo->structValue->emplace("ID", std::make_shared<BaseLib::Variable>((int32_t)peer->getID()));
+    deviceInfo->structValue->emplace("CHANNELS", channels);
+    oldAddresses->arrayValue->push_back(std::make_shared<BaseLib::Variable>(oldSerialNumber));
+    if (peer->getRpcDevice()) {
+      for (auto &function : peer->getRpcDevice()->functions) {
+        oldAddresses->arrayValue->push_back(std::make_shared<BaseLib::Variable>(oldSerialNumber + ":" + std::to_string(function.first)));
+        channels->arrayValue->push_back(std::make_shared<BaseLib::Variable>(function.first));
+      }
+    }
+    auto interface = GD::interfaces->getInterface(interfaceId);
+    if (interface) interface->removeKnownDevices(rpcType, oldAddresses);
+
+    {
+      //Keep the peer, so its ID, names and everything else stored in Homegear stays the same. It is unreachable by its serial number while it is
+      //renamed, but "_peersMutex" is only held to update the maps.
+      std::lock_guard<std::mutex> pairGuard(_pairMutex);
+      {
+        std::lock_guard<std::mutex> peersGuard(_peersMutex);
+        _peersBySerial.erase(oldSerialNumber);
+      }
+      peer->setSerialNumber(newSerialNumber);
+      _descriptionCreator.renameDescription(oldSerialNumber, newSerialNumber, GD::family->getCcuDevices()->getSource(peer->getDeviceType()));
+      {
+        std::lock_guard<std::mutex> peersGuard(_peersMutex);
+        _peersBySerial[newSerialNumber] = peer;
+      }
+    }
+    clearServiceMessagesCache();
+
+    std::vector<uint64_t> peerIds{peer->getID()};
+    raiseRPCDeleteDevices(peerIds, oldAddresses, deviceInfo);
+    auto deviceDescriptions = std::make_shared<BaseLib::Variable>(BaseLib::VariableType::tArray);
+    auto descriptions = peer->getDeviceDescriptions(nullptr, true, std::map<std::string, bool>());
+    if (descriptions) deviceDescriptions->arrayValue->insert(deviceDescriptions->arrayValue->end(), descriptions->begin(), descriptions->end());
+    raiseRPCNewDevices(peerIds, deviceDescriptions);
+
+    //The new device might be a different model or have a different firmware.
+    peer.reset();
+    queueDescriptionUpdate(rpcType, interfaceId, newSerialNumber, PVariable());
+  }
+  catch (const std::exception &ex) {
+    GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+  }
+}
+
 void MyCentral::searchDevicesThread(std::string interfaceId) {
   try {
     auto interfaces = GD::interfaces->getInterfaces();
@@ -776,9 +1335,10 @@ void MyCentral::searchDevicesThread(std::string interfaceId) {
             if (serialNumber.find(':') != std::string::npos) continue;
             std::string interfaceId = interface->getID();
             std::unordered_map<int32_t, std::string> names;
-            auto deviceNameIterator = deviceNames.find(serialNumber);
-            if (deviceNameIterator != deviceNames.end()) names = deviceNameIterator->second;
-            pairDevice(Ccu::RpcType::bidcos, interfaceId, serialNumber, names);
+            auto deviceNameIterator = deviceNames->find(serialNumber);
+            if (deviceNameIterator != deviceNames->end()) names = deviceNameIterator->second;
+            auto versionIterator = description->structValue->find("VERSION");
+            pairDevice(Ccu::RpcType::bidcos, interfaceId, serialNumber, names, versionIterator == description->structValue->end() ? -1 : versionIterator->second->integerValue);
           }
         }
       }
@@ -796,9 +1356,10 @@ void MyCentral::searchDevicesThread(std::string interfaceId) {
             if (serialNumber.find(':') != std::string::npos) continue;
             std::string interfaceId = interface->getID();
             std::unordered_map<int32_t, std::string> names;
-            auto deviceNameIterator = deviceNames.find(serialNumber);
-            if (deviceNameIterator != deviceNames.end()) names = deviceNameIterator->second;
-            pairDevice(Ccu::RpcType::hmip, interfaceId, serialNumber, names);
+            auto deviceNameIterator = deviceNames->find(serialNumber);
+            if (deviceNameIterator != deviceNames->end()) names = deviceNameIterator->second;
+            auto versionIterator = description->structValue->find("VERSION");
+            pairDevice(Ccu::RpcType::hmip, interfaceId, serialNumber, names, versionIterator == description->structValue->end() ? -1 : versionIterator->second->integerValue);
           }
         }
       }
@@ -822,9 +1383,10 @@ void MyCentral::searchDevicesThread(std::string interfaceId) {
               if (serialNumber.find(':') != std::string::npos) continue;
               std::string interfaceId = interface->getID();
               std::unordered_map<int32_t, std::string> names;
-              auto deviceNameIterator = deviceNames.find(serialNumber);
-              if (deviceNameIterator != deviceNames.end()) names = deviceNameIterator->second;
-              pairDevice(Ccu::RpcType::wired, interfaceId, serialNumber, names);
+              auto deviceNameIterator = deviceNames->find(serialNumber);
+              if (deviceNameIterator != deviceNames->end()) names = deviceNameIterator->second;
+              auto versionIterator = description->structValue->find("VERSION");
+              pairDevice(Ccu::RpcType::wired, interfaceId, serialNumber, names, versionIterator == description->structValue->end() ? -1 : versionIterator->second->integerValue);
             }
           }
         }
@@ -843,9 +1405,10 @@ void MyCentral::searchDevicesThread(std::string interfaceId) {
             if (serialNumber.find(':') != std::string::npos) continue;
             std::string interfaceId = interface->getID();
             std::unordered_map<int32_t, std::string> names;
-            auto deviceNameIterator = deviceNames.find(serialNumber);
-            if (deviceNameIterator != deviceNames.end()) names = deviceNameIterator->second;
-            pairDevice(Ccu::RpcType::hmvirtual, interfaceId, serialNumber, names);
+            auto deviceNameIterator = deviceNames->find(serialNumber);
+            if (deviceNameIterator != deviceNames->end()) names = deviceNameIterator->second;
+            auto versionIterator = description->structValue->find("VERSION");
+            pairDevice(Ccu::RpcType::hmvirtual, interfaceId, serialNumber, names, versionIterator == description->structValue->end() ? -1 : versionIterator->second->integerValue);
           }
         }
       }
@@ -857,6 +1420,287 @@ void MyCentral::searchDevicesThread(std::string interfaceId) {
   _searching = false;
 }
 
+void MyCentral::hydrateValues() {
+  try {
+    auto interfaces = GD::interfaces->getInterfaces();
+    for (auto &interface : interfaces) {
+      if (_disposing || _shuttingDown) return;
+      std::string interfaceId = interface->getID();
+      if (_hydratedInterfaces.find(interfaceId) != _hydratedInterfaces.end()) continue;
+
+      GD::out.printInfo("Info: Loading current values from CCU " + interfaceId + "...");
+
+      std::unordered_map<std::string, std::unordered_map<int32_t, PVariable>> newValues;
+      std::unordered_map<std::string, std::unordered_map<int32_t, std::unordered_map<std::string, int64_t>>> timestamps;
+      std::unordered_map<std::string, std::shared_ptr<MyPeer>> peers;
+      auto result = interface->getDatapointValues([&](const std::string &address, const std::string &name, const std::string &value, int64_t timestamp) {
+        auto addressPair = BaseLib::HelperFunctions::splitFirst(address, ':');
+        if (addressPair.second.empty()) return;
+
+        std::shared_ptr<MyPeer> peer;
+        auto peerIterator = peers.find(addressPair.first);
+        if (peerIterator == peers.end()) {
+          peer = getPeer(addressPair.first);
+          if (peer && peer->getPhysicalInterfaceId() != interfaceId) peer.reset();
+          peers.emplace(addressPair.first, peer);
+        } else peer = peerIterator->second;
+        if (!peer) return;
+
+        int32_t channel = BaseLib::Math::getNumber(addressPair.second);
+        auto convertedValue = peer->convertRegaValue(channel, name, value);
+        if (!convertedValue) return;
+
+        auto &channelValues = newValues[addressPair.first][channel];
+        if (!channelValues) channelValues = std::make_shared<BaseLib::Variable>(BaseLib::VariableType::tStruct);
+        channelValues->structValue->emplace(name, convertedValue);
+        //The timestamps are on the local clock. "updateValues" ignores values changed on the CCU before their last event.
+        timestamps[addressPair.first][channel][name] = timestamp;
+      });
+      if (!result) continue;
+
+      int32_t changedValues = 0;
+      for (auto &peerValues : newValues) {
+        auto &peer = peers.at(peerValues.first);
+        for (auto &channelValues : peerValues.second) {
+          changedValues += peer->updateValues(channelValues.first, channelValues.second, timestamps[peerValues.first][channelValues.first]);
+        }
+      }
+
+      _hydratedInterfaces.emplace(interfaceId);
+      GD::out.printInfo("Info: Values of CCU " + interfaceId + " loaded. " + std::to_string(changedValues) + " values changed.");
+    }
+  }
+  catch (const std::exception &ex) {
+    GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+  }
+}
+
+void MyCentral::resyncThread() {
+  try {
+    while (!_disposing && !_shuttingDown) {
+      std::pair<std::string, Ccu::RpcType> request;
+      {
+        std::lock_guard<std::mutex> resyncGuard(_resyncThreadMutex);
+        if (_resyncRequests.empty()) {
+          _resyncing = false;
+          return;
+        }
+        request = *_resyncRequests.begin();
+        _resyncRequests.erase(_resyncRequests.begin());
+      }
+
+      //The daemon was restarted or Homegear reconnected, so the CCU doesn't know the value usage anymore.
+      if (_reportValueUsage && request.second == Ccu::RpcType::hmip) reportValueUsage(request.first, true);
+      resyncValues(request.first, request.second);
+    }
+  }
+  catch (const std::exception &ex) {
+    GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+  }
+  //"dispose" releases the mutex before joining this thread. Requests left are processed by the next resync thread.
+  std::lock_guard<std::mutex> resyncGuard(_resyncThreadMutex);
+  _resyncing = false;
+}
+
+std::shared_ptr<const MyPeer::EventRateLimit> MyCentral::getEventRateLimit(const std::shared_ptr<MyPeer> &peer) {
+  try {
+    auto rpcDevice = peer->getRpcDevice();
+    if (!_eventRateLimitsByType.empty() && rpcDevice && !rpcDevice->supportedDevices.empty()) {
+      auto eventRateLimitIterator = _eventRateLimitsByType.find(rpcDevice->supportedDevices.front()->id);
+      if (eventRateLimitIterator != _eventRateLimitsByType.end()) return eventRateLimitIterator->second;
+    }
+  }
+  catch (const std::exception &ex) {
+    GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+  }
+  return _defaultEventRateLimit;
+}
+
+void MyCentral::eventsCoalesced(uint64_t peerId) {
+  std::lock_guard<std::mutex> coalescingPeersGuard(_coalescingPeersMutex);
+  _coalescingPeers.emplace(peerId);
+}
+
+void MyCentral::processCoalescedEvents() {
+  try {
+    std::set<uint64_t> coalescingPeers;
+    {
+      std::lock_guard<std::mutex> coalescingPeersGuard(_coalescingPeersMutex);
+      if (_coalescingPeers.empty()) return;
+      coalescingPeers.swap(_coalescingPeers);
+    }
+
+    std::set<uint64_t> pendingPeers;
+    for (auto peerId : coalescingPeers) {
+      auto peer = getPeer(peerId);
+      if (peer && peer->processCoalescedEvents()) pendingPeers.emplace(peerId);
+    }
+
+    if (!pendingPeers.empty()) {
+      std::lock_guard<std::mutex> coalescingPeersGuard(_coalescingPeersMutex);
+      _coalescingPeers.insert(pendingPeers.begin(), pendingPeers.end());
+    }
+  }
+  catch (const std::exception &ex) {
+    GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+  }
+}
+
+void MyCentral::reportValueUsage(const std::string &interfaceId, bool force) {
+  try {
+    std::string id = interfaceId;
+    auto interface = GD::interfaces->getInterface(id);
+    if (!interface || !interface->hasHmip()) return;
+
+    std::vector<std::shared_ptr<MyPeer>> peers;
+    {
+      std::lock_guard<std::mutex> peersGuard(_peersMutex);
+      peers.reserve(_peersById.size());
+      for (auto &peerBase : _peersById) {
+        auto peer = std::dynamic_pointer_cast<MyPeer>(peerBase.second);
+        if (!peer || peer->getPhysicalInterfaceId() != interfaceId || peer->getRpcType() != Ccu::RpcType::hmip) continue;
+        peers.push_back(peer);
+      }
+    }
+
+    //Elements: address, parameter, reference count
+    std::vector<std::tuple<std::string, std::string, int32_t>> changes;
+    {
+      std::lock_guard<std::mutex> reportedValueUsageGuard(_reportedValueUsageMutex);
+      for (auto &peer : peers) {
+        auto valueUsage = peer->getValueUsage(_valueUsagePolicy);
+        for (auto &usage : valueUsage) {
+          std::string address = peer->getSerialNumber() + ":" + std::to_string(usage.channel);
+          int32_t referenceCount = usage.used ? 1 : 0;
+          auto &reportedReferenceCount = _reportedValueUsage.emplace(interfaceId + "." + address + "." + usage.name, -1).first->second;
+          if (!force && reportedReferenceCount == referenceCount) continue;
+          reportedReferenceCount = referenceCount;
+          changes.emplace_back(address, usage.name, referenceCount);
+        }
+      }
+    }
+    if (changes.empty()) return;
+
+    GD::out.printInfo("Info: Reporting usage of " + std::to_string(changes.size()) + " values to CCU " + interfaceId + ".");
+    auto getParameters = [&](size_t index) {
+      BaseLib::PArray parameters = std::make_shared<BaseLib::Array>();
+      parameters->reserve(3);
+      parameters->push_back(std::make_shared<BaseLib::Variable>(std::get<0>(changes.at(index))));
+      parameters->push_back(std::make_shared<BaseLib::Variable>(std::get<1>(changes.at(index))));
+      parameters->push_back(std::make_shared<BaseLib::Variable>(std::get<2>(changes.at(index))));
+      return parameters;
+    };
+    if (!invokeBatched(interface, Ccu::RpcType::hmip, "reportValueUsage", changes.size(), _valueUsageBatchSize, 0, getParameters, nullptr)) {
+      //Report everything again next time.
+      std::lock_guard<std::mutex> reportedValueUsageGuard(_reportedValueUsageMutex);
+      for (auto &change : changes) {
+        _reportedValueUsage.erase(interfaceId + "." + std::get<0>(change) + "." + std::get<1>(change));
+      }
+    }
+  }
+  catch (const std::exception &ex) {
+    GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+  }
+}
+
+bool MyCentral::invokeBatched(const std::shared_ptr<Ccu> &interface, Ccu::RpcType rpcType, const std::string &methodName, size_t callCount, uint32_t batchSize, uint32_t batchInterval, const std::function<BaseLib::PArray(size_t index)> &getParameters, const std::function<void(size_t index, const BaseLib::PVariable &result)> &processResult) {
+  try {
+    if (batchSize == 0) batchSize = 1;
+    for (size_t batchStart = 0; batchStart < callCount; batchStart += batchSize) {
+      if (_disposing || _shuttingDown) return false;
+      if (batchStart > 0) {
+        for (uint32_t i = 0; i < batchInterval / 100; i++) {
+          if (_disposing || _shuttingDown) return false;
+          std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+      }
+      size_t batchEnd = std::min(callCount, batchStart + batchSize);
+
+      auto calls = std::make_shared<BaseLib::Variable>(BaseLib::VariableType::tArray);
+      calls->arrayValue->reserve(batchEnd - batchStart);
+      for (size_t i = batchStart; i < batchEnd; i++) {
+        auto call = std::make_shared<BaseLib::Variable>(BaseLib::VariableType::tStruct);
+        call->structValue->emplace("methodName", std::make_shared<BaseLib::Variable>(methodName));
+        call->structValue->emplace("params", std::make_shared<BaseLib::Variable>(getParameters(i)));
+        calls->arrayValue->push_back(call);
+      }
+
+      BaseLib::PArray parameters = std::make_shared<BaseLib::Array>();
+      parameters->push_back(calls);
+      auto result = interface->invoke(rpcType, "system.multicall", parameters);
+      if (result->errorStruct) {
+        GD::out.printWarning("Warning: Error calling " + methodName + " on CCU " + interface->getID() + ": " + result->structValue->at("faultString")->stringValue);
+        return false;
+      }
+
+      if (!processResult) continue;
+      for (size_t i = 0; i < result->arrayValue->size() && batchStart + i < batchEnd; i++) {
+        processResult(batchStart + i, result->arrayValue->at(i));
+      }
+    }
+    return true;
+  }
+  catch (const std::exception &ex) {
+    GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+  }
+  return false;
+}
+
+void MyCentral::resyncValues(const std::string &interfaceId, Ccu::RpcType rpcType) {
+  try {
+    std::string id = interfaceId;
+    auto interface = GD::interfaces->getInterface(id);
+    if (!interface) return;
+
+    std::vector<std::shared_ptr<MyPeer>> peers;
+    {
+      std::lock_guard<std::mutex> peersGuard(_peersMutex);
+      peers.reserve(_peersById.size());
+      for (auto &peerBase : _peersById) {
+        auto peer = std::dynamic_pointer_cast<MyPeer>(peerBase.second);
+        if (!peer || peer->getPhysicalInterfaceId() != interfaceId || peer->getRpcType() != rpcType) continue;
+        peers.push_back(peer);
+      }
+    }
+    if (peers.empty()) return;
+
+    std::sort(peers.begin(), peers.end(), [](const std::shared_ptr<MyPeer> &a, const std::shared_ptr<MyPeer> &b) { return a->getLastValueUpdate() > b->getLastValueUpdate(); });
+
+    std::vector<std::pair<std::shared_ptr<MyPeer>, int32_t>> channels;
+    for (auto &peer : peers) {
+      auto rpcDevice = peer->getRpcDevice();
+      if (!rpcDevice) continue;
+      for (auto &function : rpcDevice->functions) {
+        if (!function.second->variables || function.second->variables->parameters.empty()) continue;
+        channels.emplace_back(peer, function.first);
+      }
+    }
+
+    GD::out.printInfo("Info: Resyncing values of " + std::to_string(channels.size()) + " channels on CCU " + interfaceId + " (" + std::to_string((int32_t)rpcType) + ").");
+
+    int32_t changedValues = 0;
+    auto getParameters = [&](size_t index) {
+      BaseLib::PArray parameters = std::make_shared<BaseLib::Array>();
+      parameters->reserve(2);
+      parameters->push_back(std::make_shared<BaseLib::Variable>(channels.at(index).first->getSerialNumber() + ":" + std::to_string(channels.at(index).second)));
+      parameters->push_back(std::make_shared<BaseLib::Variable>(std::string("VALUES")));
+      return parameters;
+    };
+    auto processResult = [&](size_t index, const PVariable &result) {
+      //Successful calls return an array containing the result, failed calls a fault struct.
+      if (result->type != BaseLib::VariableType::tArray || result->arrayValue->empty()) return;
+      auto &channel = channels.at(index);
+      changedValues += channel.first->updateValues(channel.second, result->arrayValue->at(0));
+    };
+    if (!invokeBatched(interface, rpcType, "getParamset", channels.size(), _resyncBatchSize, _resyncBatchInterval, getParameters, processResult)) return;
+
+    GD::out.printInfo("Info: Resync on CCU " + interfaceId + " (" + std::to_string((int32_t)rpcType) + ") completed. " + std::to_string(changedValues) + " values changed.");
+  }
+  catch (const std::exception &ex) {
+    GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+  }
+}
+
 PVariable MyCentral::getPairingState(BaseLib::PRpcClientInfo clientInfo) {
   try {
     auto states = std::make_shared<BaseLib::Variable>(BaseLib::VariableType::tStruct);
@@ -920,183 +1764,110 @@ PVariable MyCentral::searchDevices(BaseLib::PRpcClientInfo clientInfo, const std
   return Variable::createError(-32500, "Unknown application error.");
 }
 
-PVariable MyCentral::searchInterfaces(BaseLib::PRpcClientInfo clientInfo, BaseLib::PVariable metadata) {
-  PFileDescriptor serverSocketDescriptor;
+std::set<std::string> MyCentral::getInterfaceSerialNumbers() {
+  std::set<std::string> serialNumbers;
   try {
-    bool addNewInterfaces = true;
-    if (metadata) {
-      auto metadataIterator = metadata->structValue->find("addNewInterfaces");
-      if (metadataIterator != metadata->structValue->end()) addNewInterfaces = metadataIterator->second->booleanValue;
-    }
-    int32_t newInterfaceCount = 0;
-
-    //{{{ UDP search
-    serverSocketDescriptor = _bl->fileDescriptorManager.add(socket(AF_INET, SOCK_DGRAM, 0));
-    if (serverSocketDescriptor->descriptor == -1) {
-      _bl->out.printError("Error: Could not create socket.");
-      return Variable::createError(-1, "Could not create socket.");
-    }
-
-    int32_t reuse = 1;
-    if (setsockopt(serverSocketDescriptor->descriptor, SOL_SOCKET, SO_REUSEADDR, (char *)&reuse, sizeof(reuse)) == -1) {
-      _bl->out.printWarning("Warning: Could set socket options: " + std::string(strerror(errno)));
+    auto interfaces = GD::interfaces->getInterfaces();
+    for (auto &interface : interfaces) {
+      if (!interface->getSerialNumber().empty()) serialNumbers.emplace(interface->getSerialNumber());
     }
+  }
+  catch (const std::exception &ex) {
+    GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+  }
+  return serialNumbers;
+}
 
-    char loopch = 0;
-    if (setsockopt(serverSocketDescriptor->descriptor, IPPROTO_IP, IP_MULTICAST_LOOP, (char *)&loopch, sizeof(loopch)) == -1) {
-      _bl->out.printWarning("Warning: Could set socket options: " + std::string(strerror(errno)));
+void MyCentral::discoveryResult(const CcuDiscovery::DiscoveredCcu &ccu) {
+  try {
+    std::string serial = ccu.serialNumber;
+    auto interface = GD::interfaces->getInterfaceBySerial(serial);
+    if (interface) {
+      if (interface->getHost() != ccu.ipAddress) GD::interfaces->setInterfaceHost(interface, ccu.ipAddress);
+      return;
     }
-
-    struct in_addr localInterface;
-    localInterface.s_addr = inet_addr("0.0.0.0");
-    if (setsockopt(serverSocketDescriptor->descriptor, IPPROTO_IP, IP_MULTICAST_IF, (char *)&localInterface, sizeof(localInterface)) == -1) {
-      _bl->out.printWarning("Warning: Could set socket options: " + std::string(strerror(errno)));
+    //Only add new CCUs when they answered a search that asked for it.
+    if (!ccu.searchResponse || !_addNewInterfaces) return;
+
+    Systems::PPhysicalInterfaceSettings settings = std::make_shared<Systems::PhysicalInterfaceSettings>();
+    settings->id = serial;
+    settings->type = "ccu-auto";
+    settings->host = ccu.ipAddress;
+    settings->serialNumber = serial;
+    settings->port = "2001";
+    settings->port2 = "2010";
+    settings->port3 = "2000";
+    settings->port4 = "9292";
+    _newInterfaceCount++;
+
+    std::shared_ptr<Ccu> newInterface = GD::interfaces->addInterface(settings, true);
+    if (newInterface) {
+      GD::out.printInfo("Info: Found new CCU with IP address " + ccu.ipAddress + " and serial number " + settings->id + ".");
+      newInterface->startListening();
+      GD::interfaces->addEventHandlers((BaseLib::Systems::IPhysicalInterface::IPhysicalInterfaceEventSink *)this);
     }
+  }
+  catch (const std::exception &ex) {
+    GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+  }
+}
 
-    struct sockaddr_in localSock;
-    memset((char *)&localSock, 0, sizeof(localSock));
-    localSock.sin_family = AF_INET;
-    localSock.sin_port = 0;
-    localSock.sin_addr.s_addr = inet_addr("239.255.255.250");
-
-    if (bind(serverSocketDescriptor->descriptor.load(), (struct sockaddr *)&localSock, sizeof(localSock)) == -1) {
-      _bl->out.printError("Error: Binding failed: " + std::string(strerror(errno)));
-      _bl->fileDescriptorManager.close(serverSocketDescriptor);
-      return Variable::createError(-2, "Binding failed.");
-    }
+void MyCentral::startInterfaceSearch() {
+  try {
+    if (!_discovery) return;
+    std::unique_lock<std::mutex> interfaceSearchGuard(_interfaceSearchMutex, std::try_to_lock);
+    if (!interfaceSearchGuard.owns_lock() || _discovery->searching()) return;
+    _addNewInterfaces = false;
+    _discovery->search(getInterfaceSerialNumbers(), 5000, 0, nullptr);
+  }
+  catch (const std::exception &ex) {
+    GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+  }
+}
 
-    struct sockaddr_in addessInfo;
-    addessInfo.sin_family = AF_INET;
-    addessInfo.sin_addr.s_addr = inet_addr("239.255.255.250");
-    addessInfo.sin_port = htons(43439);
+PVariable MyCentral::searchInterfaces(BaseLib::PRpcClientInfo clientInfo, BaseLib::PVariable metadata) {
+  try {
+    if (!_discovery) return Variable::createError(-1, "CCU discovery is not available.");
 
-    std::vector<uint8_t> broadcastPacket{2, 0xBE, 0x41, 0xD8, 1, 0x65, 0x51, 0x33, 0x2D, 0x2A, 0, 0x2A, 0, 0x49};
-    if (sendto(serverSocketDescriptor->descriptor, (char *)broadcastPacket.data(), broadcastPacket.size(), 0, (struct sockaddr *)&addessInfo, sizeof(addessInfo)) == -1) {
-      _bl->out.printWarning("Warning: Could send SSDP search broadcast packet: " + std::string(strerror(errno)));
+    bool addNewInterfaces = true;
+    if (metadata) {
+      auto metadataIterator = metadata->structValue->find("addNewInterfaces");
+      if (metadataIterator != metadata->structValue->end()) addNewInterfaces = metadataIterator->second->booleanValue;
     }
 
-    uint64_t startTime = _bl->hf.getTime();
-    char buffer[1024];
-    int32_t bytesReceived = 0;
-    struct sockaddr info{};
-    socklen_t slen = sizeof(info);
-    fd_set readFileDescriptor;
-    timeval socketTimeout;
-    int32_t nfds = 0;
-    std::vector<uint8_t> expectedResponse{2, 0xBE, 0x41, 0xD8, 1};
-    std::set<std::string> foundInterfaces;
-    while (_bl->hf.getTime() - startTime <= 5000) {
-      try {
-        if (!serverSocketDescriptor || serverSocketDescriptor->descriptor == -1) break;
-
-        socketTimeout.tv_sec = 0;
-        socketTimeout.tv_usec = 100000;
-        FD_ZERO(&readFileDescriptor);
-        auto fileDescriptorGuard = _bl->fileDescriptorManager.getLock();
-        fileDescriptorGuard.lock();
-        nfds = serverSocketDescriptor->descriptor + 1;
-        if (nfds <= 0) {
-          fileDescriptorGuard.unlock();
-          _bl->out.printError("Error: Socket closed (1).");
-          _bl->fileDescriptorManager.shutdown(serverSocketDescriptor);
-          continue;
-        }
-        FD_SET(serverSocketDescriptor->descriptor, &readFileDescriptor);
-        fileDescriptorGuard.unlock();
-        bytesReceived = select(nfds, &readFileDescriptor, NULL, NULL, &socketTimeout);
-        if (bytesReceived == 0) continue;
-        if (bytesReceived != 1) {
-          _bl->out.printError("Error: Socket closed (2).");
-          _bl->fileDescriptorManager.shutdown(serverSocketDescriptor);
-          continue;
-        }
-
-        bytesReceived = recvfrom(serverSocketDescriptor->descriptor, buffer, 1024, 0, &info, &slen);
-        if (bytesReceived == 0 || info.sa_family != AF_INET) continue;
-        else if (bytesReceived == -1) {
-          _bl->out.printError("Error: Socket closed (3).");
-          _bl->fileDescriptorManager.shutdown(serverSocketDescriptor);
-          continue;
-        }
-        if (_bl->debugLevel >= 5) _bl->out.printDebug("Debug: Response received:\n" + std::string(buffer, bytesReceived));
-        std::vector<uint8_t> responseStart(buffer, buffer + 5);
-        if (responseStart == expectedResponse) {
-          char *pos = (char *)memchr(buffer + 5, 0, bytesReceived - 5);
-          if (pos) {
-            std::string device(buffer + 5, pos - (buffer + 5));
-            if (device == "eQ3-HM-CCU2-App" || device == "eQ3-HmIP-CCU3-App") {
-              pos = (char *)memchr(buffer + 5 + device.size() + 1, 0, bytesReceived - 5 - device.size() - 1);
-              if (pos) {
-                std::string serial(buffer + 5 + device.size() + 1, pos - (buffer + 5 + device.size() + 1));
-                serial = BaseLib::HelperFunctions::stripNonAlphaNumeric(serial);
-
-                pos = (char *)memchr(buffer + 5 + device.size() + 1 + serial.size() + 4, 0, bytesReceived - 5 - device.size() - 1 - serial.size() - 4);
-                if (pos) {
-                  std::string version(buffer + 5 + device.size() + 1 + serial.size() + 4, pos - (buffer + 5 + device.size() + 1 + serial.size() + 4));
-
-                  struct sockaddr_in *s = (struct sockaddr_in *)&info;
-                  char ipStringBuffer[INET6_ADDRSTRLEN];
-                  inet_ntop(AF_INET, &s->sin_addr, ipStringBuffer, sizeof(ipStringBuffer));
-                  std::string senderIp(ipStringBuffer);
-
-                  if (serial.empty() || senderIp.empty()) continue;
-                  auto interface = GD::interfaces->getInterfaceBySerial(serial);
-                  if (interface && interface->getHostname() == senderIp) continue;
-
-                  if (!interface) newInterfaceCount++;
-
-                  Systems::PPhysicalInterfaceSettings settings = std::make_shared<Systems::PhysicalInterfaceSettings>();
-                  settings->id = serial;
-                  if (interface) {
-                    settings->type = interface->getType();
-                    settings->host = senderIp;
-                    settings->serialNumber = serial;
-                    settings->port = interface->getPort1();
-                    settings->port2 = interface->getPort2();
-                    settings->port3 = interface->getPort3();
-                    settings->port4 = interface->getPort4();
-                  } else if (addNewInterfaces) {
-                    settings->type = "ccu-auto";
-                    settings->host = senderIp;
-                    settings->serialNumber = serial;
-                    settings->port = "2001";
-                    settings->port2 = "2010";
-                    settings->port3 = "2000";
-                    settings->port4 = "9292";
-                  }
-
-                  if (interface || addNewInterfaces) {
-                    foundInterfaces.emplace(serial);
-
-                    std::shared_ptr<Ccu> newInterface = GD::interfaces->addInterface(settings, true);
-                    if (newInterface) {
-                      GD::out.printInfo("Info: Found new CCU with IP address " + senderIp + " and serial number " + settings->id + ".");
-                      newInterface->startListening();
-                    }
-                  }
-                }
-              }
-            } else GD::out.printInfo("Info: Ignoring unknown device: " + device);
-          }
+    const uint32_t timeout = 5000;
+    std::lock_guard<std::mutex> interfaceSearchGuard(_interfaceSearchMutex);
+    auto foundInterfacesPromise = std::make_shared<std::promise<std::set<std::string>>>();
+    auto foundInterfacesFuture = foundInterfacesPromise->get_future();
+
+    //Wait for a background search to finish. Known CCUs answer within a few hundred milliseconds, so only new CCUs need the minimum duration.
+    int64_t startTime = BaseLib::HelperFunctions::getTime();
+    while (true) {
+      if (!_discovery->searching()) {
+        _addNewInterfaces = addNewInterfaces;
+        _newInterfaceCount = 0;
+        if (_discovery->search(getInterfaceSerialNumbers(), timeout, addNewInterfaces ? 1000 : 0, [foundInterfacesPromise](const std::set<std::string> &serialNumbers) {
+          foundInterfacesPromise->set_value(serialNumbers);
+        })) {
+          break;
         }
       }
-      catch (const std::exception &ex) {
-        _bl->out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
-      }
+      if (BaseLib::HelperFunctions::getTime() - startTime > timeout || _disposing) return Variable::createError(-2, "Could not start search.");
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
     }
 
-    _bl->fileDescriptorManager.shutdown(serverSocketDescriptor);
-    //}}}
-
-    if (!foundInterfaces.empty()) GD::interfaces->addEventHandlers((BaseLib::Systems::IPhysicalInterface::IPhysicalInterfaceEventSink *)this);
+    if (foundInterfacesFuture.wait_for(std::chrono::milliseconds(timeout + 1000)) != std::future_status::ready) {
+      return Variable::createError(-3, "Search did not finish in time.");
+    }
+    std::set<std::string> foundInterfaces = foundInterfacesFuture.get();
     if (addNewInterfaces) GD::interfaces->removeUnknownInterfaces(foundInterfaces);
+    _addNewInterfaces = false;
 
-    return std::make_shared<Variable>(newInterfaceCount);
+    return std::make_shared<Variable>(_newInterfaceCount.load());
   }
   catch (const std::exception &ex) {
     GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
   }
-  _bl->fileDescriptorManager.shutdown(serverSocketDescriptor);
   return Variable::createError(-32500, "Unknown application error.");
 }
 
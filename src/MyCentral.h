@@ -33,10 +33,14 @@
 #include "MyPeer.h"
 #include "MyPacket.h"
 #include "DescriptionCreator.h"
+#include "CcuDiscovery.h"
 #include <homegear-base/BaseLib.h>
 
+#include <deque>
+#include <functional>
 #include <memory>
 #include <mutex>
+#include <set>
 #include <string>
 
 namespace MyFamily
@@ -55,6 +59,11 @@ public:
 	std::string handleCliCommand(std::string command);
 	virtual bool onPacketReceived(std::string& senderId, std::shared_ptr<BaseLib::Systems::Packet> packet);
 
+	/**
+	 * Called by peers when they start to coalesce events because of their rate limit.
+	 */
+	void eventsCoalesced(uint64_t peerId);
+
 	uint64_t getPeerIdFromSerial(std::string& serialNumber) { std::shared_ptr<MyPeer> peer = getPeer(serialNumber); if(peer) return peer->getID(); else return 0; }
 	std::shared_ptr<MyPeer> getPeer(uint64_t id);
 	std::shared_ptr<MyPeer> getPeer(std::string serialNumber);
@@ -78,12 +87,93 @@ protected:
 	std::mutex _searchDevicesThreadMutex;
 	std::thread _searchDevicesThread;
 
+	std::set<std::string> _hydratedInterfaces;
+
+	/**
+	 * Add devices announced by the CCU outside of pairing mode ("autoAddDevices").
+	 */
+	std::atomic_bool _autoAddDevices{false};
+
+	//{{{ Peer loading
+	uint32_t _maxPeerLoadThreads = 4;
+	size_t _minPeersPerLoadThread = 25;
+	//}}}
+
+	std::shared_ptr<const MyPeer::UnchangedValueSuppression> _unchangedValueSuppression;
+
+	//{{{ Event rate limit
+	std::shared_ptr<const MyPeer::EventRateLimit> _defaultEventRateLimit;
+	std::unordered_map<std::string, std::shared_ptr<const MyPeer::EventRateLimit>> _eventRateLimitsByType;
+	std::mutex _coalescingPeersMutex;
+	std::set<uint64_t> _coalescingPeers;
+	//}}}
+
+	//{{{ Value usage reporting
+	std::atomic_bool _reportValueUsage{false};
+	std::unordered_map<std::string, bool> _valueUsagePolicy;
+	std::atomic<uint32_t> _valueUsageBatchSize{50};
+	std::mutex _reportedValueUsageMutex;
+
+	/**
+	 * The reference counts last reported to the CCUs by "<interface ID>.<address>.<parameter>".
+	 */
+	std::unordered_map<std::string, int32_t> _reportedValueUsage;
+	//}}}
+
+	//{{{ CCU discovery
+	std::unique_ptr<CcuDiscovery> _discovery;
+	std::mutex _interfaceSearchMutex;
+	std::atomic_bool _addNewInterfaces{false};
+	std::atomic<int32_t> _newInterfaceCount{0};
+	//}}}
+
+	//{{{ Value resync after reconnects
+	const uint32_t _resyncBatchSize = 20;
+	const uint32_t _resyncBatchInterval = 1000;
+	std::atomic_bool _resyncing{false};
+	std::mutex _resyncThreadMutex;
+	std::thread _resyncThread;
+	std::set<std::pair<std::string, Ccu::RpcType>> _resyncRequests;
+	//}}}
+
+	//{{{ Description updates
+	struct DescriptionUpdate
+	{
+		Ccu::RpcType rpcType;
+		std::string interfaceId;
+		std::string serialNumber;
+		PVariable deviceDescription;
+	};
+
+	std::atomic_bool _updatingDescriptions{false};
+	std::mutex _descriptionUpdateThreadMutex;
+	std::thread _descriptionUpdateThread;
+	std::deque<DescriptionUpdate> _descriptionUpdates;
+	//}}}
+
+	//{{{ Service message cache
+	struct ServiceMessagesCacheEntry
+	{
+		std::shared_ptr<const Ccu::ServiceMessages> snapshot;
+		std::vector<PVariable> elementsWithId;
+		std::vector<PVariable> elements;
+	};
+
+	std::mutex _serviceMessagesCacheMutex;
+	std::unordered_map<std::string, ServiceMessagesCacheEntry> _serviceMessagesCache;
+	//}}}
+
     std::mutex _pairMutex;
     DescriptionCreator _descriptionCreator;
 
 	virtual void init();
 	void worker();
 	virtual void loadPeers();
+
+	/**
+	 * Loads peers from the given rows until all rows are taken. Called by several threads at once.
+	 */
+	void loadPeersThread(std::vector<BaseLib::Database::DataRow*>& rows, std::atomic<size_t>& nextRow, std::mutex& loadedPeersMutex, std::vector<std::shared_ptr<MyPeer>>& loadedPeers);
 	virtual void savePeers(bool full);
 	virtual void loadVariables() {}
 	virtual void saveVariables() {}
@@ -91,8 +181,99 @@ protected:
 	void deletePeer(uint64_t id);
 
     void pairingModeTimer(int32_t duration, bool debugOutput = true);
-    void pairDevice(Ccu::RpcType rpcType, std::string& interfaceId, std::string& serialNumber, std::unordered_map<int32_t, std::string>& names);
+
+    /**
+     * Creates or updates the peer for a CCU device.
+     *
+     * @param version The VERSION of the device description as reported by the CCU or -1 if unknown. If the existing peer's description has the same
+     * version, the description is not recreated.
+     * @param systemVariablesDescription Only used for the system variable peer (RpcType::rega). The parameter set description of its VALUES.
+     */
+    void pairDevice(Ccu::RpcType rpcType, std::string& interfaceId, std::string& serialNumber, std::unordered_map<int32_t, std::string>& names, int32_t version = -1, PVariable systemVariablesDescription = PVariable());
+
+    /**
+     * Updates the description of a known device when its firmware or description version changed. Only changed parameter sets are fetched from the
+     * CCU. The parameters of the peer are migrated in place, so the device doesn't need to be paired again. The caller must not hold a reference to the
+     * peer.
+     *
+     * @param deviceDescription The device description as passed to "newDevices". When nullptr, the description is checked for changes without
+     * comparing the versions first.
+     */
+    void updateDescription(Ccu::RpcType rpcType, std::string& interfaceId, std::string& serialNumber, const PVariable& deviceDescription);
+
+    /**
+     * Calls "updateDescription" in "_descriptionUpdateThread". Fetching changed parameter sets and waiting for the only reference to the peer can take
+     * up to a minute, which must not block the thread processing the CCU's packets.
+     */
+    void queueDescriptionUpdate(Ccu::RpcType rpcType, const std::string& interfaceId, const std::string& serialNumber, const PVariable& deviceDescription);
+    void descriptionUpdateThread();
+
+    /**
+     * Removes the devices of a "newDevices" call without a peer on this interface from the device fingerprint of the CCU. Otherwise they would be
+     * reported as known by "listDevices" and never be announced again.
+     */
+    void removeUnpairedDevices(Ccu::RpcType rpcType, std::string& interfaceId, const PVariable& deviceDescriptions);
+
+    /**
+     * Moves a peer to the serial number of the device replacing it on the CCU. RPC clients see the old device deleted and the new one added. If the new
+     * device's description differs, the peer is migrated like after a firmware update.
+     */
+    void replaceDevice(Ccu::RpcType rpcType, std::string& interfaceId, std::string& oldSerialNumber, std::string& newSerialNumber);
 	void searchDevicesThread(std::string interfaceId);
+
+	/**
+	 * Called by the CCU discovery for every CCU found. Updates the IP address of known CCUs and adds new CCUs when requested by the running search.
+	 */
+	void discoveryResult(const CcuDiscovery::DiscoveredCcu& ccu);
+
+	/**
+	 * Starts a CCU search without waiting for it to finish. Does nothing if a search is already running.
+	 */
+	void startInterfaceSearch();
+	std::set<std::string> getInterfaceSerialNumbers();
+	void resyncThread();
+
+	void clearServiceMessagesCache();
+
+	/**
+	 * Returns the event rate limit for the device type of a peer or nullptr when events are not limited.
+	 */
+	std::shared_ptr<const MyPeer::EventRateLimit> getEventRateLimit(const std::shared_ptr<MyPeer>& peer);
+
+	/**
+	 * Lets all peers with coalesced events process them as far as their rate limits allow.
+	 */
+	void processCoalescedEvents();
+
+	/**
+	 * Calls "reportValueUsage" on the HomeMatic IP daemon of a CCU for the values of its peers covered by "_valueUsagePolicy", so the CCU only sends
+	 * values which are needed.
+	 *
+	 * @param force Report all values. Otherwise only values with a changed usage are reported.
+	 */
+	void reportValueUsage(const std::string& interfaceId, bool force);
+
+	/**
+	 * Calls "methodName" "callCount" times on a CCU daemon in "system.multicall"s of up to "batchSize" calls, waiting "batchInterval" milliseconds
+	 * between them.
+	 *
+	 * @param getParameters Returns the parameters of the call with the given index.
+	 * @param processResult Called with the index and the result of every call. Failed calls return a fault struct. Can be nullptr.
+	 * @return Returns false when a multicall failed or the central is disposing.
+	 */
+	bool invokeBatched(const std::shared_ptr<Ccu>& interface, Ccu::RpcType rpcType, const std::string& methodName, size_t callCount, uint32_t batchSize, uint32_t batchInterval, const std::function<BaseLib::PArray(size_t index)>& getParameters, const std::function<void(size_t index, const BaseLib::PVariable& result)>& processResult);
+
+	/**
+	 * Updates the values of all peers with the datapoint values stored in ReGa for all CCUs not hydrated yet. Only values changed after the last update
+	 * of the same parameter in Homegear are applied.
+	 */
+	void hydrateValues();
+
+	/**
+	 * Fetches the VALUES paramsets of all peers connected to the given CCU daemon in batched multicalls and raises events for all changed values.
+	 * Peers with the most recent value changes are processed first.
+	 */
+	void resyncValues(const std::string& interfaceId, Ccu::RpcType rpcType);
 };
 
 }
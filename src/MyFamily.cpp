@@ -28,6 +28,9 @@
  */
 
 #include "GD.h"
+#include "CcuDevices.h"
+#include "DescriptionCache.h"
+#include "DescriptionCreator.h"
 #include "Interfaces.h"
 #include "MyFamily.h"
 #include "MyCentral.h"
@@ -42,6 +45,7 @@ MyFamily::MyFamily(BaseLib::SharedObjects* bl, BaseLib::Systems::IFamilyEventSin
 	GD::out.init(bl);
 	GD::out.setPrefix(std::string("Module ") + MY_FAMILY_NAME + ": ");
 	GD::out.printDebug("Debug: Loading module...");
+	_rpcDevices = std::make_shared<CcuDevices>(bl, this, MY_FAMILY_ID);
     if(!enabled()) return;
 	GD::interfaces = std::make_shared<Interfaces>(bl, _settings->getPhysicalInterfaceSettings());
     _physicalInterfaces = GD::interfaces;
@@ -54,11 +58,8 @@ MyFamily::~MyFamily()
 
 bool MyFamily::init()
 {
-	_bl->out.printInfo("Loading XML RPC devices...");
-	std::string xmlPath = _bl->settings.familyDataPath() + std::to_string(GD::family->getFamily()) + "/desc/";
-	BaseLib::Io io;
-	io.init(_bl);
-	if(BaseLib::Io::directoryExists(xmlPath) && !io.getFiles(xmlPath).empty()) _rpcDevices->load(xmlPath);
+	_bl->out.printInfo("Loading RPC devices...");
+	loadRpcDevices();
 	return true;
 }
 
@@ -72,9 +73,41 @@ void MyFamily::dispose()
 
 void MyFamily::reloadRpcDevices()
 {
-    _bl->out.printInfo("Reloading XML RPC devices...");
-    std::string xmlPath = _bl->settings.familyDataPath() + std::to_string(GD::family->getFamily()) + "/desc/";
-    if(BaseLib::Io::directoryExists(xmlPath)) _rpcDevices->load(xmlPath);
+    _bl->out.printInfo("Reloading RPC devices...");
+    loadRpcDevices();
+}
+
+void MyFamily::loadRpcDevices()
+{
+    try
+    {
+        DescriptionCache descriptionCache;
+        std::unordered_map<uint32_t, PVariable> sources;
+        auto devices = descriptionCache.load(sources);
+
+        //Descriptions created on demand are unknown to "Devices::find" and to the list of supported devices, so this is opt-in.
+        std::string settingName = "loadDescriptionsOnDemand";
+        auto setting = getFamilySetting(settingName);
+        std::string loadDescriptionsOnDemandString = setting ? setting->stringValue : "";
+        bool loadDescriptionsOnDemand = (setting && setting->integerValue == 1) || BaseLib::HelperFunctions::toLower(loadDescriptionsOnDemandString) == "true";
+        if(!loadDescriptionsOnDemand)
+        {
+            //The sources are kept, because they are needed to update descriptions, e. g. after firmware updates.
+            DescriptionCreator descriptionCreator;
+            devices.reserve(devices.size() + sources.size());
+            for(auto& source : sources)
+            {
+                auto device = descriptionCreator.createDevice(source.second);
+                if(device) devices.push_back(device);
+            }
+        }
+
+        getCcuDevices()->setDevices(devices, sources, loadDescriptionsOnDemand);
+    }
+    catch(const std::exception& ex)
+    {
+        GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+    }
 }
 
 void MyFamily::createCentral()
@@ -30,6 +30,7 @@
 #ifndef MYFAMILY_H_
 #define MYFAMILY_H_
 
+#include "CcuDevices.h"
 #include <homegear-base/BaseLib.h>
 
 using namespace BaseLib;
@@ -49,9 +50,20 @@ public:
 	virtual bool hasPhysicalInterface() { return false; }
 	virtual PVariable getPairingInfo();
     void reloadRpcDevices();
+
+    /**
+     * Returns the RPC devices of the family. Use "CcuDevices::get" to look up descriptions, so descriptions not used yet are created on demand.
+     */
+    std::shared_ptr<CcuDevices> getCcuDevices() { return std::static_pointer_cast<CcuDevices>(_rpcDevices); }
 protected:
 	virtual std::shared_ptr<BaseLib::Systems::ICentral> initializeCentral(uint32_t deviceId, int32_t address, std::string serialNumber);
 	virtual void createCentral();
+
+	/**
+	 * Loads all device descriptions using the description cache. Cached descriptions are only created on demand when "loadDescriptionsOnDemand" is
+	 * enabled.
+	 */
+	void loadRpcDevices();
 };
 
 }
@@ -30,6 +30,7 @@
 #ifndef MYPACKET_H_
 #define MYPACKET_H_
 
+#include "EventFilter.h"
 #include <homegear-base/BaseLib.h>
 
 namespace MyFamily
@@ -44,9 +45,16 @@ class MyPacket : public BaseLib::Systems::Packet
 
         std::string getMethodName() { return _methodName; }
         BaseLib::PArray getParameters() { return _parameters; }
+
+        /**
+         * The action of the event filter for "event" packets.
+         */
+        EventFilter::Action getFilterAction() { return _filterAction; }
+        void setFilterAction(EventFilter::Action value) { _filterAction = value; }
     protected:
         std::string _methodName;
         BaseLib::PArray _parameters;
+        EventFilter::Action _filterAction = EventFilter::Action::none;
 };
 
 typedef std::shared_ptr<MyPacket> PMyPacket;
@@ -109,6 +109,7 @@ void MyPeer::homegearShuttingDown()
     try
     {
         _shuttingDown = true;
+        saveVariable(21, (int64_t)_lastValueUpdate);
         Peer::homegearShuttingDown();
     }
     catch(const std::exception& ex)
@@ -265,11 +266,31 @@ void MyPeer::setPhysicalInterfaceId(std::string id)
     if(id.empty() || interface)
     {
         _physicalInterfaceId = id;
+        _currentInterfaceGeneration = 0;
         setPhysicalInterface(id.empty() ? GD::interfaces->getDefaultInterface() : interface);
         saveVariable(19, _physicalInterfaceId);
     }
 }
 
+std::shared_ptr<Ccu> MyPeer::getCurrentInterface()
+{
+    try
+    {
+        uint64_t generation = GD::interfaces->getGeneration();
+        if(generation == _currentInterfaceGeneration.load(std::memory_order_acquire)) return std::atomic_load(&_currentInterface);
+
+        auto interface = GD::interfaces->getInterface(_physicalInterfaceId);
+        std::atomic_store(&_currentInterface, interface);
+        _currentInterfaceGeneration.store(generation, std::memory_order_release);
+        return interface;
+    }
+    catch(const std::exception& ex)
+    {
+        GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+    }
+    return std::shared_ptr<Ccu>();
+}
+
 void MyPeer::setPhysicalInterface(std::shared_ptr<Ccu> interface)
 {
     try
@@ -290,7 +311,7 @@ void MyPeer::loadVariables(BaseLib::Systems::ICentral* central, std::shared_ptr<
         if(!rows) rows = _bl->db->getPeerVariables(_peerID);
         Peer::loadVariables(central, rows);
 
-        _rpcDevice = GD::family->getRpcDevices()->find(_deviceType, _firmwareVersion, -1);
+        _rpcDevice = GD::family->getCcuDevices()->get(_deviceType, _firmwareVersion);
         if(!_rpcDevice) return;
 
         for(BaseLib::Database::DataTable::iterator row = rows->begin(); row != rows->end(); ++row)
@@ -300,13 +321,16 @@ void MyPeer::loadVariables(BaseLib::Systems::ICentral* central, std::shared_ptr<
                 case 19:
                 {
                     _physicalInterfaceId = row->second.at(4)->textValue;
-                    auto interface = GD::interfaces->getInterface(_physicalInterfaceId);
+                    auto interface = getCurrentInterface();
                     if(!_physicalInterfaceId.empty() && interface) setPhysicalInterface(interface);
                     break;
                 }
                 case 20:
                     _rpcType = (Ccu::RpcType)row->second.at(3)->intValue;
                     break;
+                case 21:
+                    _lastValueUpdate = row->second.at(3)->intValue;
+                    break;
             }
         }
         if(!_physicalInterface)
@@ -329,6 +353,7 @@ void MyPeer::saveVariables()
         Peer::saveVariables();
         saveVariable(19, _physicalInterfaceId);
         saveVariable(20, (int32_t)_rpcType);
+        saveVariable(21, (int64_t)_lastValueUpdate);
     }
     catch(const std::exception& ex)
     {
@@ -405,36 +430,187 @@ void MyPeer::packetReceived(PMyPacket& packet)
     try
     {
         if(_disposing || !packet || !_rpcDevice) return;
-        if(packet->getMethodName() != "event") return;
+        if(packet->getMethodName() != "event" || packet->getParameters()->size() < 4) return;
+        if(_eventRateLimit && !takeEventToken(packet)) return;
+        processEvent(packet);
+    }
+    catch(const std::exception& ex)
+    {
+        GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+    }
+}
+
+void MyPeer::refillEventTokens(int64_t time)
+{
+    auto rateLimit = _eventRateLimit;
+    if(!rateLimit) return;
+    if(_eventTokens < 0) _eventTokens = rateLimit->burst;
+    else if(time > _lastEventTokenRefill) _eventTokens = std::min(rateLimit->burst, _eventTokens + (time - _lastEventTokenRefill) * rateLimit->rate / 1000.0);
+    _lastEventTokenRefill = time;
+}
+
+bool MyPeer::takeEventToken(PMyPacket& packet)
+{
+    try
+    {
+        std::string key = BaseLib::HelperFunctions::splitFirst(packet->getParameters()->at(1)->stringValue, ':').second + "." + packet->getParameters()->at(2)->stringValue;
+        int64_t time = BaseLib::HelperFunctions::getTime();
+        bool startedCoalescing = false;
+        {
+            std::lock_guard<std::mutex> eventRateLimitGuard(_eventRateLimitMutex);
+            refillEventTokens(time);
+            if(_eventTokens >= 1)
+            {
+                _eventTokens -= 1;
+                //A coalesced older value of the same parameter is outdated now.
+                _coalescedEvents.erase(key);
+                return true;
+            }
+
+            startedCoalescing = _coalescedEvents.empty();
+            _coalescedEvents[key] = packet;
+            //A new burst after a break of more than 10 seconds starts a new period. The central might not have called "processCoalescedEvents" since.
+            if(time - _lastRateLimited > 10000) _rateLimitedSince = 0;
+            if(_rateLimitedSince == 0) _rateLimitedSince = time;
+            _lastRateLimited = time;
+        }
+
+        if(startedCoalescing)
+        {
+            auto central = std::dynamic_pointer_cast<MyCentral>(getCentral());
+            if(central) central->eventsCoalesced(_peerID);
+        }
+    }
+    catch(const std::exception& ex)
+    {
+        GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+    }
+    return false;
+}
+
+bool MyPeer::processCoalescedEvents()
+{
+    try
+    {
+        if(_disposing) return false;
+
+        std::vector<PMyPacket> packets;
+        bool setServiceMessage = false;
+        bool unsetServiceMessage = false;
+        bool pending = false;
+        int64_t time = BaseLib::HelperFunctions::getTime();
+        {
+            std::lock_guard<std::mutex> eventRateLimitGuard(_eventRateLimitMutex);
+            refillEventTokens(time);
+            while(_eventTokens >= 1 && !_coalescedEvents.empty())
+            {
+                packets.push_back(_coalescedEvents.begin()->second);
+                _coalescedEvents.erase(_coalescedEvents.begin());
+                _eventTokens -= 1;
+            }
+
+            //The limit is hit persistently, when events were coalesced without a break of 10 seconds for one minute.
+            if(_rateLimitedSince != 0 && time - _lastRateLimited > 10000) _rateLimitedSince = 0;
+            if(!_rateLimitServiceMessage && _rateLimitedSince != 0 && time - _rateLimitedSince >= 60000)
+            {
+                _rateLimitServiceMessage = true;
+                setServiceMessage = true;
+            }
+            else if(_rateLimitServiceMessage && _rateLimitedSince == 0)
+            {
+                _rateLimitServiceMessage = false;
+                unsetServiceMessage = true;
+            }
+            pending = !_coalescedEvents.empty() || _rateLimitServiceMessage;
+        }
 
+        for(auto& packet : packets)
+        {
+            processEvent(packet);
+        }
+
+        if(setServiceMessage)
+        {
+            GD::out.printWarning("Warning: Peer " + std::to_string(_peerID) + " (" + _serialNumber + ") is sending more events than allowed by its rate limit for more than one minute. Events are coalesced.");
+            auto data = std::make_shared<BaseLib::Variable>(BaseLib::VariableType::tStruct);
+            data->structValue->emplace("SERIALNUMBER", std::make_shared<BaseLib::Variable>(_serialNumber));
+            _bl->globalServiceMessages.set(MY_FAMILY_ID,
+                                           _physicalInterfaceId,
+                                           _peerID,
+                                           "eventRateLimit",
+                                           BaseLib::ServiceMessagePriority::kWarning,
+                                           BaseLib::HelperFunctions::getTimeSeconds(),
+                                           "l10n.ccu.serviceMessage.eventRateLimit",
+                                           std::list<std::string>{_serialNumber, std::to_string(_peerID)},
+                                           data,
+                                           1);
+        }
+        else if(unsetServiceMessage)
+        {
+            GD::out.printInfo("Info: Event rate of peer " + std::to_string(_peerID) + " (" + _serialNumber + ") is back to normal.");
+            _bl->globalServiceMessages.unset(MY_FAMILY_ID, _peerID, "eventRateLimit", "l10n.ccu.serviceMessage.eventRateLimit");
+        }
+
+        return pending;
+    }
+    catch(const std::exception& ex)
+    {
+        GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+    }
+    return false;
+}
+
+void MyPeer::processEvent(PMyPacket& packet)
+{
+    try
+    {
         auto addressPair = BaseLib::HelperFunctions::splitFirst(packet->getParameters()->at(1)->stringValue, ':');
         int32_t channel = BaseLib::Math::getNumber(addressPair.second);
 
         std::string variableName = packet->getParameters()->at(2)->stringValue;
         BaseLib::PVariable value = packet->getParameters()->at(3);
 
-        auto channelIterator = valuesCentral.find(channel);
-        if(channelIterator == valuesCentral.end()) return;
-
-        auto variableIterator = channelIterator->second.find(variableName);
-        if(variableIterator == channelIterator->second.end()) return;
+        std::map<uint32_t, std::shared_ptr<std::vector<std::string>>> valueKeys;
+        std::map<uint32_t, std::shared_ptr<std::vector<PVariable>>> rpcValues;
+        {
+            //Events are processed by the event dispatch thread and, when rate limited, by the worker.
+            std::lock_guard<std::mutex> valueUpdateGuard(_valueUpdateMutex);
+            auto channelIterator = valuesCentral.find(channel);
+            if(channelIterator == valuesCentral.end()) return;
 
-        BaseLib::Systems::RpcConfigurationParameter& parameter = variableIterator->second;
-        if(!parameter.rpcParameter) return;
+            auto variableIterator = channelIterator->second.find(variableName);
+            if(variableIterator == channelIterator->second.end()) return;
 
-        std::vector<uint8_t> binaryValue;
-        parameter.rpcParameter->convertToPacket(value, parameter.mainRole(), binaryValue);
-        parameter.setBinaryData(binaryValue);
-        if(parameter.databaseId > 0) saveParameter(parameter.databaseId, binaryValue);
-        else saveParameter(0, ParameterGroup::Type::Enum::variables, channel, variableName, binaryValue);
-        if(_bl->debugLevel >= 4) GD::out.printInfo("Info: " + variableName + " of peer " + std::to_string(_peerID) + " with serial number " + _serialNumber + ":" + std::to_string(channel) + " was set to 0x" + BaseLib::HelperFunctions::getHexString(binaryValue) + ".");
+            BaseLib::Systems::RpcConfigurationParameter& parameter = variableIterator->second;
+            if(!parameter.rpcParameter) return;
 
-        std::map<uint32_t, std::shared_ptr<std::vector<std::string>>> valueKeys;
-        std::map<uint32_t, std::shared_ptr<std::vector<PVariable>>> rpcValues;
-        valueKeys[channel] = std::make_shared<std::vector<std::string>>();
-        rpcValues[channel] = std::make_shared<std::vector<PVariable>>();
-        valueKeys[channel]->push_back(variableName);
-        rpcValues[channel]->push_back(parameter.rpcParameter->convertFromPacket(binaryValue, parameter.mainRole(), true));
+            std::vector<uint8_t> binaryValue;
+            parameter.rpcParameter->convertToPacket(value, parameter.mainRole(), binaryValue);
+            int64_t time = BaseLib::HelperFunctions::getTime();
+            _valueUpdateTimes[channel][variableName] = time;
+            auto filterAction = packet->getFilterAction();
+            //"_lastValueUpdate" is stored in the database, so values only kept in memory must not change it.
+            if(_unchangedValueSuppression && suppressUnchangedValue(channel, variableName, parameter, binaryValue))
+            {
+                if(filterAction != EventFilter::Action::memory) _lastValueUpdate = time;
+                return;
+            }
+            parameter.setBinaryData(binaryValue);
+            if(filterAction != EventFilter::Action::memory)
+            {
+                if(parameter.databaseId > 0) saveParameter(parameter.databaseId, binaryValue);
+                else saveParameter(0, ParameterGroup::Type::Enum::variables, channel, variableName, binaryValue);
+                _lastValueUpdate = time;
+            }
+            if(_bl->debugLevel >= 4) GD::out.printInfo("Info: " + variableName + " of peer " + std::to_string(_peerID) + " with serial number " + _serialNumber + ":" + std::to_string(channel) + " was set to 0x" + BaseLib::HelperFunctions::getHexString(binaryValue) + ".");
+            //Filtered values are only stored.
+            if(filterAction == EventFilter::Action::memory || filterAction == EventFilter::Action::persist) return;
+
+            valueKeys[channel] = std::make_shared<std::vector<std::string>>();
+            rpcValues[channel] = std::make_shared<std::vector<PVariable>>();
+            valueKeys[channel]->push_back(variableName);
+            rpcValues[channel]->push_back(parameter.rpcParameter->convertFromPacket(binaryValue, parameter.mainRole(), true));
+        }
 
         for(std::map<uint32_t, std::shared_ptr<std::vector<std::string>>>::iterator j = valueKeys.begin(); j != valueKeys.end(); ++j)
         {
@@ -452,11 +628,166 @@ void MyPeer::packetReceived(PMyPacket& packet)
     }
 }
 
+bool MyPeer::suppressUnchangedValue(int32_t channel, const std::string& name, BaseLib::Systems::RpcConfigurationParameter& parameter, const std::vector<uint8_t>& binaryValue)
+{
+    try
+    {
+        //Actions like "PRESS_SHORT" have the same value on every event.
+        if(parameter.rpcParameter->logical->type == ILogical::Type::Enum::tAction) return false;
+
+        auto suppression = _unchangedValueSuppression;
+        int64_t maxSilence = suppression->maxSilence;
+        auto maxSilenceIterator = suppression->maxSilenceByParameter.find(name);
+        if(maxSilenceIterator != suppression->maxSilenceByParameter.end()) maxSilence = maxSilenceIterator->second;
+        if(maxSilence <= 0) return false;
+
+        int64_t time = BaseLib::HelperFunctions::getTime();
+        std::string key = std::to_string(channel) + "." + name;
+        std::lock_guard<std::mutex> lastForwardedValuesGuard(_lastForwardedValuesMutex);
+        auto& lastForwarded = _lastForwardedValues[key];
+        if(binaryValue == parameter.getBinaryData() && time - lastForwarded < maxSilence) return true;
+        lastForwarded = time;
+    }
+    catch(const std::exception& ex)
+    {
+        GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+    }
+    return false;
+}
+
+int32_t MyPeer::updateValues(int32_t channel, PVariable values, const std::unordered_map<std::string, int64_t>& timestamps)
+{
+    try
+    {
+        if(_disposing || !values || values->type != VariableType::tStruct || !_rpcDevice) return 0;
+
+        std::shared_ptr<std::vector<std::string>> valueKeys = std::make_shared<std::vector<std::string>>();
+        std::shared_ptr<std::vector<PVariable>> rpcValues = std::make_shared<std::vector<PVariable>>();
+        std::unique_lock<std::mutex> valueUpdateGuard(_valueUpdateMutex);
+        auto channelIterator = valuesCentral.find(channel);
+        if(channelIterator == valuesCentral.end()) return 0;
+        auto& valueUpdateTimes = _valueUpdateTimes[channel];
+        int64_t time = BaseLib::HelperFunctions::getTime();
+
+        for(auto& value : *values->structValue)
+        {
+            auto variableIterator = channelIterator->second.find(value.first);
+            if(variableIterator == channelIterator->second.end()) continue;
+
+            BaseLib::Systems::RpcConfigurationParameter& parameter = variableIterator->second;
+            if(!parameter.rpcParameter) continue;
+
+            auto timestampIterator = timestamps.find(value.first);
+            if(timestampIterator != timestamps.end())
+            {
+                //The value was updated by an event after it was changed on the CCU, so the stored value is newer.
+                auto valueUpdateTimeIterator = valueUpdateTimes.find(value.first);
+                if(valueUpdateTimeIterator != valueUpdateTimes.end() && timestampIterator->second <= valueUpdateTimeIterator->second) continue;
+            }
+
+            std::vector<uint8_t> binaryValue;
+            parameter.rpcParameter->convertToPacket(value.second, parameter.mainRole(), binaryValue);
+            if(binaryValue == parameter.getBinaryData()) continue;
+
+            valueUpdateTimes[value.first] = time;
+            parameter.setBinaryData(binaryValue);
+            if(parameter.databaseId > 0) saveParameter(parameter.databaseId, binaryValue);
+            else saveParameter(0, ParameterGroup::Type::Enum::variables, channel, value.first, binaryValue);
+            if(_bl->debugLevel >= 4) GD::out.printInfo("Info: " + value.first + " of peer " + std::to_string(_peerID) + " with serial number " + _serialNumber + ":" + std::to_string(channel) + " was set to 0x" + BaseLib::HelperFunctions::getHexString(binaryValue) + ".");
+
+            valueKeys->push_back(value.first);
+            rpcValues->push_back(parameter.rpcParameter->convertFromPacket(binaryValue, parameter.mainRole(), true));
+        }
+
+        valueUpdateGuard.unlock();
+
+        if(valueKeys->empty()) return 0;
+        _lastValueUpdate = time;
+
+        std::string eventSource = "device-" + std::to_string(_peerID);
+        std::string address(_serialNumber + ":" + std::to_string(channel));
+        raiseEvent(eventSource, _peerID, channel, valueKeys, rpcValues);
+        raiseRPCEvent(eventSource, _peerID, channel, address, valueKeys, rpcValues);
+
+        return valueKeys->size();
+    }
+    catch(const std::exception& ex)
+    {
+        GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+    }
+    return 0;
+}
+
+void MyPeer::serviceMessageChanged(const std::string& message, bool value)
+{
+    try
+    {
+        if(_disposing || !_rpcDevice) return;
+
+        auto channelIterator = valuesCentral.find(0);
+        if(channelIterator != valuesCentral.end() && channelIterator->second.find(message) != channelIterator->second.end())
+        {
+            PVariable values = std::make_shared<Variable>(VariableType::tStruct);
+            values->structValue->emplace(message, std::make_shared<Variable>(value));
+            updateValues(0, values);
+            return;
+        }
+
+        std::shared_ptr<std::vector<std::string>> valueKeys = std::make_shared<std::vector<std::string>>();
+        std::shared_ptr<std::vector<PVariable>> rpcValues = std::make_shared<std::vector<PVariable>>();
+        valueKeys->push_back(message);
+        rpcValues->push_back(std::make_shared<Variable>(value));
+
+        std::string eventSource = "device-" + std::to_string(_peerID);
+        std::string address(_serialNumber + ":0");
+        raiseEvent(eventSource, _peerID, 0, valueKeys, rpcValues);
+        raiseRPCEvent(eventSource, _peerID, 0, address, valueKeys, rpcValues);
+    }
+    catch(const std::exception& ex)
+    {
+        GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+    }
+}
+
+PVariable MyPeer::convertRegaValue(int32_t channel, const std::string& name, const std::string& value)
+{
+    try
+    {
+        auto channelIterator = valuesCentral.find(channel);
+        if(channelIterator == valuesCentral.end()) return PVariable();
+        auto variableIterator = channelIterator->second.find(name);
+        if(variableIterator == channelIterator->second.end() || !variableIterator->second.rpcParameter || !variableIterator->second.rpcParameter->logical) return PVariable();
+
+        switch(variableIterator->second.rpcParameter->logical->type)
+        {
+            case ILogical::Type::Enum::tBoolean:
+            case ILogical::Type::Enum::tAction:
+                return std::make_shared<Variable>(value == "true" || value == "1");
+            case ILogical::Type::Enum::tInteger:
+            case ILogical::Type::Enum::tEnum:
+                return std::make_shared<Variable>(BaseLib::Math::getNumber(value));
+            case ILogical::Type::Enum::tInteger64:
+                return std::make_shared<Variable>(BaseLib::Math::getNumber64(value));
+            case ILogical::Type::Enum::tFloat:
+                return std::make_shared<Variable>(BaseLib::Math::getDouble(value));
+            case ILogical::Type::Enum::tString:
+                return std::make_shared<Variable>(value);
+            default:
+                return PVariable();
+        }
+    }
+    catch(const std::exception& ex)
+    {
+        GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+    }
+    return PVariable();
+}
+
 PVariable MyPeer::getValueFromDevice(PParameter& parameter, int32_t channel, bool asynchronous)
 {
     try
     {
-        auto interface = GD::interfaces->getInterface(_physicalInterfaceId);
+        auto interface = getCurrentInterface();
         if(!interface)
         {
             GD::out.printError("Error: Peer " + std::to_string(_peerID) + " could not get physical interface.");
@@ -569,6 +900,116 @@ bool MyPeer::getParamsetHook2(PRpcClientInfo clientInfo, PParameter parameter, u
     return false;
 }
 
+void MyPeer::updateRpcDevice(std::shared_ptr<HomegearDevice> device)
+{
+    try
+    {
+        if(!device) return;
+
+        auto getRpcParameter = [&](int32_t channel, ParameterGroup::Type::Enum type, const std::string& name)
+        {
+            auto functionIterator = device->functions.find(channel);
+            if(functionIterator == device->functions.end()) return PParameter();
+            PParameterGroup parameterGroup = functionIterator->second->getParameterGroup(type);
+            if(!parameterGroup) return PParameter();
+            auto parameterIterator = parameterGroup->parameters.find(name);
+            if(parameterIterator == parameterGroup->parameters.end()) return PParameter();
+            return parameterIterator->second;
+        };
+
+        //Parameters removed from the description stay in the database. They are ignored when the peer is loaded.
+        uint32_t removedParameters = 0;
+        for(auto& channel : valuesCentral)
+        {
+            for(auto parameterIterator = channel.second.begin(); parameterIterator != channel.second.end();)
+            {
+                parameterIterator->second.rpcParameter = getRpcParameter(channel.first, ParameterGroup::Type::Enum::variables, parameterIterator->first);
+                if(parameterIterator->second.rpcParameter) ++parameterIterator;
+                else
+                {
+                    parameterIterator = channel.second.erase(parameterIterator);
+                    removedParameters++;
+                }
+            }
+        }
+
+        for(auto& channel : configCentral)
+        {
+            for(auto parameterIterator = channel.second.begin(); parameterIterator != channel.second.end();)
+            {
+                parameterIterator->second.rpcParameter = getRpcParameter(channel.first, ParameterGroup::Type::Enum::config, parameterIterator->first);
+                if(parameterIterator->second.rpcParameter) ++parameterIterator;
+                else
+                {
+                    parameterIterator = channel.second.erase(parameterIterator);
+                    removedParameters++;
+                }
+            }
+        }
+
+        for(auto& channel : linksCentral)
+        {
+            for(auto& remotePeer : channel.second)
+            {
+                for(auto& remoteChannel : remotePeer.second)
+                {
+                    for(auto parameterIterator = remoteChannel.second.begin(); parameterIterator != remoteChannel.second.end();)
+                    {
+                        parameterIterator->second.rpcParameter = getRpcParameter(channel.first, ParameterGroup::Type::Enum::link, parameterIterator->first);
+                        if(parameterIterator->second.rpcParameter) ++parameterIterator;
+                        else
+                        {
+                            parameterIterator = remoteChannel.second.erase(parameterIterator);
+                            removedParameters++;
+                        }
+                    }
+                }
+            }
+        }
+
+        _rpcDevice = device;
+        initializeTypeString();
+        //Creates the parameters added by the new description.
+        initializeCentralConfig();
+
+        GD::out.printInfo("Info: Updated description of peer " + std::to_string(_peerID) + " to version " + std::to_string(device->version) + ". " + std::to_string(removedParameters) + " parameters were removed.");
+        raiseRPCUpdateDevice(_peerID, 0, _serialNumber, 0);
+    }
+    catch(const std::exception& ex)
+    {
+        GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+    }
+}
+
+std::vector<MyPeer::ValueUsage> MyPeer::getValueUsage(const std::unordered_map<std::string, bool>& policy)
+{
+    std::vector<ValueUsage> valueUsage;
+    try
+    {
+        for(auto& channel : valuesCentral)
+        {
+            for(auto& parameter : channel.second)
+            {
+                if(!parameter.second.rpcParameter || !parameter.second.rpcParameter->readable) continue;
+                //Values can be used without being assigned to a room, a category or a role, e. g. by scripts. So only the policy can mark them unused.
+                auto policyIterator = policy.find(parameter.first);
+                if(policyIterator == policy.end()) continue;
+
+                ValueUsage usage;
+                usage.channel = channel.first;
+                usage.name = parameter.first;
+                usage.used = policyIterator->second;
+                valueUsage.push_back(usage);
+            }
+        }
+    }
+    catch(const std::exception& ex)
+    {
+        GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+    }
+    return valueUsage;
+}
+
 PVariable MyPeer::getParamset(BaseLib::PRpcClientInfo clientInfo, int32_t channel, ParameterGroup::Type::Enum type, uint64_t remoteID, int32_t remoteChannel, bool checkAcls)
 {
     try
@@ -585,7 +1026,7 @@ PVariable MyPeer::getParamset(BaseLib::PRpcClientInfo clientInfo, int32_t channe
         auto central = getCentral();
         if(!central) return Variable::createError(-32500, "Could not get central.");
 
-        auto interface = GD::interfaces->getInterface(_physicalInterfaceId);
+        auto interface = getCurrentInterface();
         if(!interface)
         {
             GD::out.printError("Error: Peer " + std::to_string(_peerID) + " could not get physical interface.");
@@ -735,6 +1176,33 @@ PVariable MyPeer::putParamset(BaseLib::PRpcClientInfo clientInfo, int32_t channe
         }
         else if(type == ParameterGroup::Type::Enum::variables)
         {
+            if(_rpcType == Ccu::RpcType::rega)
+            {
+                //System variables are written with one ReGa script instead of one per value.
+                PVariable values = std::make_shared<Variable>(VariableType::tStruct);
+                for(Struct::iterator i = variables->structValue->begin(); i != variables->structValue->end(); ++i)
+                {
+                    if(i->first.empty() || !i->second) continue;
+                    if(checkAcls && !clientInfo->acls->checkVariableWriteAccess(central->getPeer(_peerID), channel, i->first)) continue;
+                    values->structValue->emplace(i->first, i->second);
+                }
+                if(values->structValue->empty()) return std::make_shared<BaseLib::Variable>();
+
+                auto interface = getCurrentInterface();
+                if(!interface) return Variable::createError(-32500, "Could not get physical interface.");
+
+                PArray parameters = std::make_shared<Array>();
+                parameters->reserve(3);
+                parameters->push_back(std::make_shared<Variable>(_serialNumber + ":" + std::to_string(channel)));
+                parameters->push_back(std::make_shared<Variable>(std::string("VALUES")));
+                parameters->push_back(values);
+                auto result = interface->invoke(_rpcType, "putParamset", parameters);
+                if(result->errorStruct) return result;
+
+                updateValues(channel, values);
+                return std::make_shared<BaseLib::Variable>();
+            }
+
             for(Struct::iterator i = variables->structValue->begin(); i != variables->structValue->end(); ++i)
             {
                 if(i->first.empty() || !i->second) continue;
@@ -747,7 +1215,7 @@ PVariable MyPeer::putParamset(BaseLib::PRpcClientInfo clientInfo, int32_t channe
             return std::make_shared<BaseLib::Variable>();
         }
 
-        auto interface = GD::interfaces->getInterface(_physicalInterfaceId);
+        auto interface = getCurrentInterface();
         if(!interface)
         {
             GD::out.printError("Error: Peer " + std::to_string(_peerID) + " could not get physical interface.");
@@ -771,7 +1239,8 @@ PVariable MyPeer::putParamset(BaseLib::PRpcClientInfo clientInfo, int32_t channe
             }
             else parameters->push_back(std::make_shared<Variable>(std::string("MASTER")));
             parameters->push_back(variables);
-            auto result =  interface->invoke(_rpcType, "putParamset", parameters);
+            //Configuration pushes can wait when the duty cycle is tight, so switching stays responsive.
+            auto result =  interface->invoke(_rpcType, "putParamset", parameters, Ccu::InvokePriority::low);
 
             if(parameterChanged) raiseRPCUpdateDevice(_peerID, channel, _serialNumber + ":" + std::to_string(channel), 0);
 
@@ -873,7 +1342,7 @@ PVariable MyPeer::setValue(BaseLib::PRpcClientInfo clientInfo, uint32_t channel,
         else saveParameter(0, ParameterGroup::Type::Enum::variables, channel, valueKey, parameterData);
         if(_bl->debugLevel >= 4) GD::out.printInfo("Info: " + valueKey + " of peer " + std::to_string(_peerID) + " with serial number " + _serialNumber + ":" + std::to_string(channel) + " was set to 0x" + BaseLib::HelperFunctions::getHexString(parameterData) + ".");
 
-        auto interface = GD::interfaces->getInterface(_physicalInterfaceId);
+        auto interface = getCurrentInterface();
         if(!interface)
         {
             GD::out.printError("Error: Peer " + std::to_string(_peerID) + " could not get physical interface.");
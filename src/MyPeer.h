@@ -63,10 +63,114 @@ public:
 
 	std::shared_ptr<Ccu>& getPhysicalInterface() { return _physicalInterface; }
 
+	/**
+	 * Returns the interface with the ID stored in the peer. The pointer is cached until the interfaces change.
+	 */
+	std::shared_ptr<Ccu> getCurrentInterface();
+
 	virtual std::string handleCliCommand(std::string command);
 	void packetReceived(PMyPacket& packet);
 
+	/**
+	 * Sets the values of a VALUES paramset returned by the CCU. Events are only raised for values that differ from the stored ones.
+	 *
+	 * @param channel The channel the paramset belongs to.
+	 * @param values The paramset as returned by "getParamset".
+	 * @param timestamps Optional local times in milliseconds the values were changed on the CCU by parameter name. Values not newer than the last
+	 * update of the parameter in Homegear are ignored.
+	 * @return Returns the number of changed values.
+	 */
+	int32_t updateValues(int32_t channel, PVariable values, const std::unordered_map<std::string, int64_t>& timestamps = std::unordered_map<std::string, int64_t>());
+
+	/**
+	 * Forwards a changed CCU service message of this peer. If channel 0 has a VALUES parameter with the message's name, it is updated like any other
+	 * value. Otherwise only an event is raised.
+	 */
+	void serviceMessageChanged(const std::string& message, bool value);
+
+	/**
+	 * Returns the time in milliseconds a value of this peer was last changed by the CCU.
+	 */
+	int64_t getLastValueUpdate() { return _lastValueUpdate; }
+
+	/**
+	 * Converts a value string as returned by a ReGa script to a variable of the type of the given VALUES parameter.
+	 *
+	 * @return Returns the converted value or nullptr if the parameter is unknown.
+	 */
+	PVariable convertRegaValue(int32_t channel, const std::string& name, const std::string& value);
+
+	/**
+	 * Settings for suppressing events of values the CCU resends unchanged.
+	 */
+	struct UnchangedValueSuppression
+	{
+		/**
+		 * The time in milliseconds after which an unchanged value is forwarded anyway.
+		 */
+		int64_t maxSilence = 0;
+
+		/**
+		 * The maximum silence by parameter name. 0 disables the suppression for a parameter.
+		 */
+		std::unordered_map<std::string, int64_t> maxSilenceByParameter;
+	};
+
+	/**
+	 * Enables the suppression of unchanged values. Pass nullptr to disable it.
+	 */
+	void setUnchangedValueSuppression(std::shared_ptr<const UnchangedValueSuppression> value) { _unchangedValueSuppression = value; }
+
+	/**
+	 * Token bucket settings for inbound events.
+	 */
+	struct EventRateLimit
+	{
+		/**
+		 * The number of events per second.
+		 */
+		double rate = 0;
+
+		/**
+		 * The maximum number of events processed at once after a quiet period.
+		 */
+		double burst = 0;
+	};
+
+	/**
+	 * Limits the rate of processed events. Events exceeding the limit are coalesced to the latest value per parameter and processed by
+	 * "processCoalescedEvents". Pass nullptr to disable the limit.
+	 */
+	void setEventRateLimit(std::shared_ptr<const EventRateLimit> value) { _eventRateLimit = value; }
+
+	/**
+	 * Processes coalesced events as far as the rate limit allows and updates the rate limit service message. Called once per second by the central.
+	 *
+	 * @return Returns false when there is nothing to do anymore.
+	 */
+	bool processCoalescedEvents();
+
+	struct ValueUsage
+	{
+		int32_t channel = 0;
+		std::string name;
+		bool used = false;
+	};
+
+	/**
+	 * Returns whether the VALUES parameters of this peer are needed. Used to tell the CCU through "reportValueUsage" which values to send.
+	 *
+	 * @param policy The configured usage by parameter name. Parameters not in the policy are not returned, so the CCU keeps sending them.
+	 */
+	std::vector<ValueUsage> getValueUsage(const std::unordered_map<std::string, bool>& policy);
+
 	virtual bool load(BaseLib::Systems::ICentral* central);
+
+	/**
+	 * Replaces the description of the peer, e. g. after a firmware update. The stored parameters are kept. Parameters the new description doesn't
+	 * contain anymore are removed and new parameters are created with their default values. No other thread may use the peer during the call.
+	 */
+	void updateRpcDevice(std::shared_ptr<HomegearDevice> device);
     virtual void savePeers() {}
 
 	virtual int32_t getChannelGroupedWith(int32_t channel) { return -1; }
@@ -101,7 +205,64 @@ protected:
 
 	bool _shuttingDown = false;
 	std::shared_ptr<Ccu> _physicalInterface;
+	std::shared_ptr<Ccu> _currentInterface;
+	std::atomic<uint64_t> _currentInterfaceGeneration{0};
 	uint32_t _lastRssiDevice = 0;
+	std::atomic<int64_t> _lastValueUpdate{0};
+
+	//{{{ Event rate limit
+	std::shared_ptr<const EventRateLimit> _eventRateLimit;
+	std::mutex _eventRateLimitMutex;
+	double _eventTokens = -1;
+	int64_t _lastEventTokenRefill = 0;
+	int64_t _rateLimitedSince = 0;
+	int64_t _lastRateLimited = 0;
+	bool _rateLimitServiceMessage = false;
+
+	/**
+	 * The events not processed yet because of the rate limit by "<channel>.<parameter>".
+	 */
+	std::unordered_map<std::string, PMyPacket> _coalescedEvents;
+
+	/**
+	 * Takes a token from the bucket. When no token is available, the event is coalesced.
+	 *
+	 * @return Returns true when the event can be processed.
+	 */
+	bool takeEventToken(PMyPacket& packet);
+	void refillEventTokens(int64_t time);
+	//}}}
+
+	/**
+	 * Serializes changes of VALUES parameters by "processEvent" and "updateValues", which are called by several threads.
+	 */
+	std::mutex _valueUpdateMutex;
+
+	/**
+	 * The local time in milliseconds each VALUES parameter was last updated by the CCU by channel and parameter name. Requires
+	 * "_valueUpdateMutex". Not stored in the database, after a restart the CCU's values are newer.
+	 */
+	std::unordered_map<int32_t, std::unordered_map<std::string, int64_t>> _valueUpdateTimes;
+
+	/**
+	 * Stores the value of an "event" call and raises events.
+	 */
+	void processEvent(PMyPacket& packet);
+
+	//{{{ Unchanged value suppression
+	std::shared_ptr<const UnchangedValueSuppression> _unchangedValueSuppression;
+	std::mutex _lastForwardedValuesMutex;
+
+	/**
+	 * The time values were last forwarded by "<channel>.<parameter>".
+	 */
+	std::unordered_map<std::string, int64_t> _lastForwardedValues;
+
+	/**
+	 * Returns true when an event of an unchanged value should not be forwarded.
+	 */
+	bool suppressUnchangedValue(int32_t channel, const std::string& name, BaseLib::Systems::RpcConfigurationParameter& parameter, const std::vector<uint8_t>& binaryValue);
+	//}}}
 
 	virtual void loadVariables(BaseLib::Systems::ICentral* central, std::shared_ptr<BaseLib::Database::DataTable>& rows);
     virtual void saveVariables();
@@ -28,9 +28,13 @@
  */
 
 #include "Ccu.h"
+#include "RegaJsonParser.h"
 #include "../GD.h"
 #include "../MyPacket.h"
 
+#include <algorithm>
+#include <cmath>
+
 namespace MyFamily {
 
 Ccu::Ccu(std::shared_ptr<BaseLib::Systems::PhysicalInterfaceSettings> settings) : IPhysicalInterface(GD::bl, GD::family->getFamily(), settings) {
@@ -64,15 +68,36 @@ Ccu::Ccu(std::shared_ptr<BaseLib::Systems::PhysicalInterfaceSettings> settings)
   _port4 = BaseLib::Math::getNumber(settings->port4);
   if ((_port4 < 1 || _port4 > 65535) && _port4 != 0) _port4 = 9292;
 
-  _httpClient = std::unique_ptr<BaseLib::HttpClient>(new HttpClient(_bl, _hostname, 8181, false, false));
+  {
+    auto connection = std::make_shared<Connection>();
+    connection->hostname = settings->host;
+    connection->regaClient = std::make_shared<BaseLib::HttpClient>(_bl, settings->host, 8181, true, false);
+    connection->regaCheckClient = std::make_shared<BaseLib::HttpClient>(_bl, settings->host, 80, true, false);
+    _connection = std::move(connection);
+  }
+  std::string settingName = "dutyCycleThreshold";
+  auto setting = GD::family->getFamilySetting(settingName);
+  if (setting && setting->integerValue > 0) _dutyCycleThreshold = setting->integerValue;
+  settingName = "dutyCycleMaxDeferral";
+  setting = GD::family->getFamilySetting(settingName);
+  if (setting && setting->integerValue >= 0) _maxDeferral = (int64_t)std::min(setting->integerValue, 10) * 1000;
+
+  _eventQueue = std::unique_ptr<EventQueue>(new EventQueue([this](PMyPacket &packet) { raisePacketReceived(packet); }));
+
+  loadKnownDevices();
 }
 
 Ccu::~Ccu() {
   _stopCallbackThread = true;
-  _stopped = true;
+  {
+    std::lock_guard<std::mutex> dutyCycleGuard(_dutyCycleMutex);
+    _stopped = true;
+  }
   _stopPingThread = true;
+  _dutyCycleConditionVariable.notify_all();
   GD::bl->threadManager.join(_initThread);
   GD::bl->threadManager.join(_pingThread);
+  _eventQueue->stop();
 }
 
 void Ccu::init() {
@@ -94,6 +119,9 @@ void Ccu::init() {
       }
     }
 
+    //Events might have been lost while the callback registration was broken, so every registration but the first one triggers a value resync.
+    bool reRegistration = _initCalled.exchange(true);
+
     _bidcosDevicesExist = false;
     _hmipNewDevicesCalled = false;
     _wiredNewDevicesCalled = false;
@@ -103,7 +131,7 @@ void Ccu::init() {
     _lastPongWired.store(BaseLib::HelperFunctions::getTime());
     _lastPongHmVirtual.store(BaseLib::HelperFunctions::getTime());
 
-    if (_bidcosClient) {
+    if (hasBidCos()) {
       try {
         auto parameters = std::make_shared<BaseLib::Array>();
         parameters->reserve(2);
@@ -113,7 +141,10 @@ void Ccu::init() {
         if (result->errorStruct) {
           _out.printError("Error calling \"init\" for HomeMatic BidCoS: " + result->structValue->at("faultString")->stringValue);
           _bidcosReInit = true;
-        } else _bidcosReInit = false;
+        } else {
+          if (reRegistration || _bidcosReInit) requestValueResync(RpcType::bidcos);
+          _bidcosReInit = false;
+        }
       }
       catch (const std::exception &ex) {
         _bidcosReInit = true;
@@ -121,7 +152,7 @@ void Ccu::init() {
       }
     }
 
-    if (_hmipClient) {
+    if (hasHmip()) {
       try {
         auto parameters = std::make_shared<BaseLib::Array>();
         parameters->reserve(2);
@@ -131,7 +162,10 @@ void Ccu::init() {
         if (result->errorStruct) {
           _out.printError("Error calling \"init\" for HomeMatic IP: " + result->structValue->at("faultString")->stringValue);
           _hmipReInit = true;
-        } else _hmipReInit = false;
+        } else {
+          if (reRegistration || _hmipReInit) requestValueResync(RpcType::hmip);
+          _hmipReInit = false;
+        }
       }
       catch (const std::exception &ex) {
         _hmipReInit = true;
@@ -139,7 +173,7 @@ void Ccu::init() {
       }
     }
 
-    if (_wiredClient) {
+    if (getConnection()->wiredClient) {
       try {
         auto parameters = std::make_shared<BaseLib::Array>();
         parameters->reserve(2);
@@ -155,7 +189,10 @@ void Ccu::init() {
             _out.printError("Error calling \"init\" for HomeMatic Wired (" + std::to_string(result->structValue->at("faultCode")->integerValue64) + "): " + result->structValue->at("faultString")->stringValue);
             _wiredReInit.store(true, std::memory_order_release);
           }
-        } else _wiredReInit.store(false, std::memory_order_release);
+        } else {
+          if (reRegistration || _wiredReInit.load(std::memory_order_acquire)) requestValueResync(RpcType::wired);
+          _wiredReInit.store(false, std::memory_order_release);
+        }
       }
       catch (const std::exception &ex) {
         _wiredReInit.store(true, std::memory_order_release);
@@ -163,7 +200,7 @@ void Ccu::init() {
       }
     }
 
-    if (_hmVirtualClient) {
+    if (hasHmVirtual()) {
       try {
         auto parameters = std::make_shared<BaseLib::Array>();
         parameters->reserve(2);
@@ -173,7 +210,10 @@ void Ccu::init() {
         if (result->errorStruct) {
           _out.printError("Error calling \"init\" for HomeMatic Virtual Devices: " + result->structValue->at("faultString")->stringValue);
           _hmVirtualReInit = true;
-        } else _hmVirtualReInit = false;
+        } else {
+          if (reRegistration || _hmVirtualReInit) requestValueResync(RpcType::hmvirtual);
+          _hmVirtualReInit = false;
+        }
       }
       catch (const std::exception &ex) {
         _hmVirtualReInit = true;
@@ -188,32 +228,45 @@ void Ccu::init() {
   }
 }
 
+void Ccu::requestValueResync(RpcType rpcType) {
+  try {
+    std::string methodName = "homegear.resyncValues";
+    auto parameters = std::make_shared<BaseLib::Array>();
+    parameters->push_back(std::make_shared<BaseLib::Variable>((int32_t)rpcType));
+    PMyPacket packet = std::make_shared<MyPacket>(methodName, parameters);
+    raisePacketReceived(packet);
+  }
+  catch (const std::exception &ex) {
+    _out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+  }
+}
+
 void Ccu::deinit() {
   try {
     BaseLib::PArray parameters = std::make_shared<BaseLib::Array>();
     parameters->reserve(2);
     parameters->push_back(std::make_shared<BaseLib::Variable>("http://" + _listenIp + ":" + std::to_string(_listenPort)));
     parameters->push_back(std::make_shared<BaseLib::Variable>(std::string("")));
-    if (_bidcosClient) {
+    if (hasBidCos()) {
       auto result = invoke(RpcType::bidcos, "init", parameters);
       if (result->errorStruct) _out.printError("Error calling (de-)\"init\" for HomeMatic BidCoS: " + result->structValue->at("faultString")->stringValue);
     }
 
-    if (_hmipClient) {
+    if (hasHmip()) {
       parameters->at(0)->stringValue = "http://" + _listenIp + ":" + std::to_string(_listenPort);
       parameters->at(1)->stringValue = "";
       auto result = invoke(RpcType::hmip, "init", parameters);
       if (result->errorStruct) _out.printError("Error calling (de-)\"init\" for HomeMatic IP: " + result->structValue->at("faultString")->stringValue);
     }
 
-    if (_wiredClient && !_wiredDisabled) {
+    if (hasWired()) {
       parameters->at(0)->stringValue = "http://" + _listenIp + ":" + std::to_string(_listenPort);
       parameters->at(1)->stringValue = "";
       auto result = invoke(RpcType::wired, "init", parameters);
       if (result->errorStruct) _out.printError("Error calling (de-)\"init\" for HomeMatic Wired: " + result->structValue->at("faultString")->stringValue);
     }
 
-    if (_hmVirtualClient) {
+    if (hasHmVirtual()) {
       parameters->at(0)->stringValue = "http://" + _listenIp + ":" + std::to_string(_listenPort);
       parameters->at(1)->stringValue = "";
       auto result = invoke(RpcType::hmvirtual, "init", parameters);
@@ -231,10 +284,12 @@ void Ccu::startListening() {
   try {
     stopListening();
 
-    _noHost = _settings->host.empty();
+    std::string hostname = getHost();
+    _noHost = hostname.empty();
 
     if (!_noHost) {
       _stopped = false;
+      _eventQueue->start();
       _lastPongBidcos.store(BaseLib::HelperFunctions::getTime());
       _lastPongHmip.store(BaseLib::HelperFunctions::getTime());
       _lastPongWired.store(BaseLib::HelperFunctions::getTime());
@@ -247,6 +302,8 @@ void Ccu::startListening() {
       _hmipReInit = false;
       _wiredReInit = false;
       _hmVirtualReInit = false;
+      _initCalled = false;
+      _nativeServiceMessageErrors = 0;
 
       C1Net::TcpServer::TcpServerInfo serverInfo;
       serverInfo.log_callback = std::bind(&Ccu::log, this, std::placeholders::_1, std::placeholders::_2);
@@ -297,15 +354,13 @@ void Ccu::startListening() {
       if (!BaseLib::Net::isIp(_listenIp)) _listenIp = BaseLib::Net::getMyIpAddress(_listenIp);
       _out.printInfo("Info: My own IP address is " + _listenIp + ".");
 
-      _out.printInfo("Info: Connecting to IP " + _hostname + " and ports " + (_port != 0 ? std::to_string(_port) : "") + (_port3 != 0 ? ", " + std::to_string(_port3) : "") + (_port2 != 0 ? ", " + std::to_string(_port2) : "")
+      _out.printInfo("Info: Connecting to IP " + hostname + " and ports " + (_port != 0 ? std::to_string(_port) : "") + (_port3 != 0 ? ", " + std::to_string(_port3) : "") + (_port2 != 0 ? ", " + std::to_string(_port2) : "")
                          + (_port4 != 0 ? ", " + std::to_string(_port4) : "") + ".");
 
-      if (_port != 0) _bidcosClient = std::unique_ptr<BaseLib::HttpClient>(new BaseLib::HttpClient(_bl, _hostname, _port, false, false));
-      if (_port2 != 0) _hmipClient = std::unique_ptr<BaseLib::HttpClient>(new BaseLib::HttpClient(_bl, _hostname, _port2, false, false));
-      if (_port3 != 0) _wiredClient = std::unique_ptr<BaseLib::HttpClient>(new BaseLib::HttpClient(_bl, _hostname, _port3, false, false));
-      if (_port4 != 0) _hmVirtualClient = std::unique_ptr<BaseLib::HttpClient>(new BaseLib::HttpClient(_bl, _hostname, _port4, false, false));
-
-      _ipAddress = BaseLib::Net::resolveHostname(_hostname);
+      {
+        std::lock_guard<std::mutex> connectionGuard(_connectionMutex);
+        publishConnection(hostname, true);
+      }
 
       _bidcosIdString = "Homegear_BidCoS_" + _listenIp + "_" + std::to_string(_listenPort);
       _hmipIdString = "Homegear_HMIP_" + _listenIp + "_" + std::to_string(_listenPort);
@@ -323,15 +378,73 @@ void Ccu::startListening() {
   }
 }
 
+bool Ccu::setHost(const std::string &host) {
+  try {
+    {
+      std::lock_guard<std::mutex> connectionGuard(_connectionMutex);
+      auto connection = getConnection();
+      if (host.empty() || host == connection->hostname) return false;
+      _out.printInfo("Info: Host of CCU changed from " + connection->hostname + " to " + host + ".");
+
+      //Requests still running on the old clients finish on them, they are destroyed together with the last reference to the old snapshot.
+      publishConnection(host, connection->bidcosClient || connection->hmipClient || connection->wiredClient || connection->hmVirtualClient);
+      _regaReadyTime = 0;
+    }
+
+    if (_stopped) return true;
+
+    //The registrations were made on the old address. Let the ping thread register the callback URLs again, which also resyncs the values.
+    if (hasBidCos()) _bidcosReInit = true;
+    if (hasHmip()) _hmipReInit = true;
+    if (hasWired()) _wiredReInit.store(true, std::memory_order_release);
+    if (hasHmVirtual()) _hmVirtualReInit = true;
+    _lastPongBidcos.store(BaseLib::HelperFunctions::getTime());
+    _lastPongHmip.store(BaseLib::HelperFunctions::getTime());
+    _lastPongWired.store(BaseLib::HelperFunctions::getTime());
+    _lastPongHmVirtual.store(BaseLib::HelperFunctions::getTime());
+    return true;
+  }
+  catch (const std::exception &ex) {
+    _out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+  }
+  return false;
+}
+
+void Ccu::publishConnection(const std::string &hostname, bool createRpcClients) {
+  try {
+    auto oldConnection = getConnection();
+    auto connection = std::make_shared<Connection>();
+    connection->hostname = hostname;
+    connection->ipAddress = BaseLib::Net::resolveHostname(hostname);
+    if (_port != 0 && (createRpcClients || oldConnection->bidcosClient)) connection->bidcosClient = std::make_shared<BaseLib::HttpClient>(_bl, hostname, _port, false, false);
+    if (_port2 != 0 && (createRpcClients || oldConnection->hmipClient)) connection->hmipClient = std::make_shared<BaseLib::HttpClient>(_bl, hostname, _port2, false, false);
+    if (_port3 != 0 && (createRpcClients || oldConnection->wiredClient)) connection->wiredClient = std::make_shared<BaseLib::HttpClient>(_bl, hostname, _port3, false, false);
+    if (_port4 != 0 && (createRpcClients || oldConnection->hmVirtualClient)) connection->hmVirtualClient = std::make_shared<BaseLib::HttpClient>(_bl, hostname, _port4, false, false);
+    connection->regaClient = std::make_shared<BaseLib::HttpClient>(_bl, hostname, 8181, true, false);
+    connection->regaCheckClient = std::make_shared<BaseLib::HttpClient>(_bl, hostname, 80, true, false);
+    std::atomic_store(&_connection, std::shared_ptr<const Connection>(std::move(connection)));
+    _noHost = hostname.empty();
+  }
+  catch (const std::exception &ex) {
+    _out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+  }
+}
+
 void Ccu::stopListening() {
   try {
     _stopPingThread = true;
 
     deinit();
 
-    _stopped = true;
+    {
+      //Set under the mutex, so a call in "waitForDutyCycle" can't miss the notification between checking the predicate and waiting.
+      std::lock_guard<std::mutex> dutyCycleGuard(_dutyCycleMutex);
+      _stopped = true;
+    }
 
+    _dutyCycleConditionVariable.notify_all();
     _bl->threadManager.join(_pingThread);
+    _eventQueue->stop();
 
     if (_server) {
       _server->Stop();
@@ -451,6 +564,11 @@ void Ccu::processPacket(const C1Net::TcpServer::PTcpClientData &client_data, std
               else if (parameters->at(0)->stringValue == _hmVirtualIdString) parameters->at(0)->integerValue = (int32_t)RpcType::hmvirtual;
               _out.printInfo("Info: CCU (" + std::to_string(parameters->at(0)->integerValue) + ") is calling RPC method " + methodNameIterator->second->stringValue);
               PMyPacket packet = std::make_shared<MyPacket>(methodNameIterator->second->stringValue, parameters);
+              if (methodNameIterator->second->stringValue == "event") {
+                dutyCycleEvent((RpcType)parameters->at(0)->integerValue, parameters);
+                if (filterEvent((RpcType)parameters->at(0)->integerValue, parameters, packet)) _eventQueue->push(packet);
+                continue;
+              }
               raisePacketReceived(packet);
             }
           }
@@ -459,21 +577,40 @@ void Ccu::processPacket(const C1Net::TcpServer::PTcpClientData &client_data, std
     } else if (methodName == "newDevices") {
       if (parameters->at(0)->stringValue == _bidcosIdString) {
         parameters->at(0)->integerValue = (int32_t)RpcType::bidcos;
-        _bidcosDevicesExist = parameters->at(1)->arrayValue->size() > 52;
+        _bidcosDevicesExist = addKnownDevices(RpcType::bidcos, parameters->at(1)) > 52;
       } else if (parameters->at(0)->stringValue == _wiredIdString) {
         parameters->at(0)->integerValue = (int32_t)RpcType::wired;
+        addKnownDevices(RpcType::wired, parameters->at(1));
         _wiredNewDevicesCalled = true;
       } else if (parameters->at(0)->stringValue == _hmVirtualIdString) {
         parameters->at(0)->integerValue = (int32_t)RpcType::hmvirtual;
+        addKnownDevices(RpcType::hmvirtual, parameters->at(1));
         _hmVirtualNewDevicesCalled = true;
       } else {
         parameters->at(0)->integerValue = (int32_t)RpcType::hmip;
+        addKnownDevices(RpcType::hmip, parameters->at(1));
         _hmipNewDevicesCalled = true;
       }
       _out.printInfo("Info: CCU (" + std::to_string(parameters->at(0)->integerValue) + ") is calling RPC method " + methodName);
       PMyPacket packet = std::make_shared<MyPacket>(methodName, parameters);
       raisePacketReceived(packet);
-    } else if (methodName == "system.listMethods" || methodName == "listDevices") {
+    } else if (methodName == "listDevices") {
+      RpcType rpcType = RpcType::hmip;
+      if (parameters->at(0)->stringValue == _bidcosIdString) rpcType = RpcType::bidcos;
+      else if (parameters->at(0)->stringValue == _wiredIdString) rpcType = RpcType::wired;
+      else if (parameters->at(0)->stringValue == _hmVirtualIdString) rpcType = RpcType::hmvirtual;
+      parameters->at(0)->integerValue = (int32_t)rpcType;
+      _out.printInfo("Info: CCU (" + std::to_string(parameters->at(0)->integerValue) + ") is calling RPC method " + methodName);
+      response = getKnownDevices(rpcType);
+
+      //The CCU only calls "newDevices" for devices missing in our response, so the keep alive checks have to be enabled here.
+      if (rpcType == RpcType::bidcos) _bidcosDevicesExist = response->arrayValue->size() > 52;
+      else if (!response->arrayValue->empty()) {
+        if (rpcType == RpcType::wired) _wiredNewDevicesCalled = true;
+        else if (rpcType == RpcType::hmvirtual) _hmVirtualNewDevicesCalled = true;
+        else _hmipNewDevicesCalled = true;
+      }
+    } else if (methodName == "system.listMethods") {
       if (parameters->at(0)->stringValue == _bidcosIdString) parameters->at(0)->integerValue = (int32_t)RpcType::bidcos;
       else if (parameters->at(0)->stringValue == _wiredIdString) parameters->at(0)->integerValue = (int32_t)RpcType::wired;
       else if (parameters->at(0)->stringValue == _hmVirtualIdString) parameters->at(0)->integerValue = (int32_t)RpcType::hmvirtual;
@@ -487,8 +624,13 @@ void Ccu::processPacket(const C1Net::TcpServer::PTcpClientData &client_data, std
         else if (parameters->at(0)->stringValue == _wiredIdString) parameters->at(0)->integerValue = (int32_t)RpcType::wired;
         else if (parameters->at(0)->stringValue == _hmVirtualIdString) parameters->at(0)->integerValue = (int32_t)RpcType::hmvirtual;
         _out.printInfo("Info: CCU (" + std::to_string(parameters->at(0)->integerValue) + ") is calling RPC method " + methodName);
+        if (methodName == "deleteDevices" && parameters->size() >= 2) removeKnownDevices((RpcType)parameters->at(0)->integerValue, parameters->at(1));
         PMyPacket packet = std::make_shared<MyPacket>(methodName, parameters);
-        raisePacketReceived(packet);
+        if (methodName != "event") raisePacketReceived(packet);
+        else {
+          dutyCycleEvent((RpcType)parameters->at(0)->integerValue, parameters);
+          if (filterEvent((RpcType)parameters->at(0)->integerValue, parameters, packet)) _eventQueue->push(packet);
+        }
       }
     }
 
@@ -515,8 +657,9 @@ void Ccu::ping() {
       }
 
       if (!isOpen()) {
+        auto ipAddress = getConnection()->ipAddress;
         auto data = std::make_shared<BaseLib::Variable>(BaseLib::VariableType::tStruct);
-        data->structValue->emplace("IP_ADDRESS", std::make_shared<BaseLib::Variable>(_ipAddress));
+        data->structValue->emplace("IP_ADDRESS", std::make_shared<BaseLib::Variable>(ipAddress));
         data->structValue->emplace("SERIALNUMBER", std::make_shared<BaseLib::Variable>(_settings->serialNumber));
         if (!_unreachable) {
           _unreachable = true;
@@ -527,7 +670,7 @@ void Ccu::ping() {
                                          BaseLib::ServiceMessagePriority::kError,
                                          BaseLib::HelperFunctions::getTimeSeconds(),
                                          "l10n.ccu.serviceMessage.ccuUnreachable",
-                                         std::list<std::string>{_settings->serialNumber, _ipAddress},
+                                         std::list<std::string>{_settings->serialNumber, ipAddress},
                                          data,
                                          1);
         }
@@ -535,55 +678,54 @@ void Ccu::ping() {
         _unreachable = false;
         _bl->globalServiceMessages.unset(MY_FAMILY_ID, 0, _settings->id, "l10n.ccu.serviceMessage.ccuUnreachable");
 
-        getCcuServiceMessages();
+        pollRega();
       }
 
-      if (_bidcosClient && _bidcosDevicesExist) {
+      if (hasBidCos() && _bidcosDevicesExist) {
         BaseLib::PArray parameters = std::make_shared<BaseLib::Array>();
         parameters->push_back(std::make_shared<BaseLib::Variable>(_bidcosIdString));
         auto result = invoke(RpcType::bidcos, "ping", parameters);
         if (result->errorStruct) {
           _out.printError("Error calling \"ping\" (BidCoS): " + result->structValue->at("faultString")->stringValue);
           _bidcosReInit = true;
-        }
+        } else updateBidcosDutyCycle();
       }
 
-      if (_bidcosClient && ((_bidcosDevicesExist && BaseLib::HelperFunctions::getTime() - _lastPongBidcos.load() > 70000) || _bidcosReInit)) {
+      if (hasBidCos() && ((_bidcosDevicesExist && BaseLib::HelperFunctions::getTime() - _lastPongBidcos.load() > 70000) || _bidcosReInit)) {
         if (regaReady()) {
           if (!_bidcosReInit) _out.printError("Error: No keep alive response received (BidCoS). Last pong: " + std::to_string(_lastPongBidcos.load()) + ". Reinitializing...");
           init();
         } else _bidcosReInit = true;
       }
 
-      if (_wiredClient && !_wiredDisabled && ((_wiredNewDevicesCalled && BaseLib::HelperFunctions::getTime() - _lastPongWired.load() > 3600000) || _wiredReInit)) {
+      if (hasWired() && ((_wiredNewDevicesCalled && BaseLib::HelperFunctions::getTime() - _lastPongWired.load() > 3600000) || _wiredReInit)) {
         if (regaReady()) {
           if (!_wiredReInit) _out.printError("Error: No keep alive received (Wired). Reinitializing...");
           init();
         } else _wiredReInit = true;
       }
 
-      if (_hmipClient && ((_hmipNewDevicesCalled && BaseLib::HelperFunctions::getTime() - _lastPongHmip.load() > 3600000) || _hmipReInit)) {
+      if (hasHmip() && ((_hmipNewDevicesCalled && BaseLib::HelperFunctions::getTime() - _lastPongHmip.load() > 3600000) || _hmipReInit)) {
         if (regaReady()) {
           if (!_hmipReInit) _out.printError("Error: No keep alive received (HM-IP). Reinitializing...");
           init();
         } else _hmipReInit = true;
       }
 
-      if (_hmVirtualClient && ((_hmVirtualNewDevicesCalled && BaseLib::HelperFunctions::getTime() - _lastPongHmVirtual.load() > 3600000) || _hmVirtualReInit)) {
+      if (hasHmVirtual() && ((_hmVirtualNewDevicesCalled && BaseLib::HelperFunctions::getTime() - _lastPongHmVirtual.load() > 3600000) || _hmVirtualReInit)) {
         if (regaReady()) {
           if (!_hmVirtualReInit) _out.printError("Error: No keep alive received (Virtual). Reinitializing...");
           init();
         } else _hmVirtualReInit = true;
       }
 
-      if (_port != 0 && !_bidcosClient) _bidcosClient = std::unique_ptr<BaseLib::HttpClient>(new BaseLib::HttpClient(_bl, _hostname, _port, false, false));
-      if (_port2 != 0 && !_hmipClient) _hmipClient = std::unique_ptr<BaseLib::HttpClient>(new BaseLib::HttpClient(_bl, _hostname, _port2, false, false));
-      if (_port3 != 0 && !_wiredClient) _wiredClient = std::unique_ptr<BaseLib::HttpClient>(new BaseLib::HttpClient(_bl, _hostname, _port3, false, false));
-      if (_port4 != 0 && !_hmVirtualClient) _hmVirtualClient = std::unique_ptr<BaseLib::HttpClient>(new BaseLib::HttpClient(_bl, _hostname, _port4, false, false));
-
-      if (_ipAddress.empty()) {
-        _ipAddress = BaseLib::Net::resolveHostname(_hostname);
-        _noHost = _hostname.empty();
+      {
+        std::lock_guard<std::mutex> connectionGuard(_connectionMutex);
+        auto connection = getConnection();
+        if ((_port != 0 && !connection->bidcosClient) || (_port2 != 0 && !connection->hmipClient) || (_port3 != 0 && !connection->wiredClient) || (_port4 != 0 && !connection->hmVirtualClient)
+            || connection->ipAddress.empty()) {
+          publishConnection(connection->hostname, true);
+        }
       }
     }
   }
@@ -592,15 +734,28 @@ void Ccu::ping() {
   }
 }
 
-BaseLib::PVariable Ccu::invoke(Ccu::RpcType rpcType, std::string methodName, BaseLib::PArray parameters) {
+BaseLib::PVariable Ccu::invoke(Ccu::RpcType rpcType, std::string methodName, BaseLib::PArray parameters, InvokePriority priority) {
   try {
     if (_stopped) return BaseLib::Variable::createError(-32500, "CCU is stopped.");
-    if (rpcType == RpcType::bidcos && !_bidcosClient) return BaseLib::Variable::createError(-32501, "HomeMatic BidCoS is disabled.");
-    else if (rpcType == RpcType::hmip && !_hmipClient) return BaseLib::Variable::createError(-32501, "HomeMatic IP is disabled.");
-    else if (rpcType == RpcType::wired && (!_wiredClient || _wiredDisabled)) return BaseLib::Variable::createError(-32501, "HomeMatic Wired is disabled.");
-    else if (rpcType == RpcType::hmvirtual && !_hmVirtualClient) return BaseLib::Variable::createError(-32501, "HomeMatic Virtual Devices are disabled.");
+    if (rpcType == RpcType::bidcos && !hasBidCos()) return BaseLib::Variable::createError(-32501, "HomeMatic BidCoS is disabled.");
+    else if (rpcType == RpcType::hmip && !hasHmip()) return BaseLib::Variable::createError(-32501, "HomeMatic IP is disabled.");
+    else if (rpcType == RpcType::wired && !hasWired()) return BaseLib::Variable::createError(-32501, "HomeMatic Wired is disabled.");
+    else if (rpcType == RpcType::hmvirtual && !hasHmVirtual()) return BaseLib::Variable::createError(-32501, "HomeMatic Virtual Devices are disabled.");
+    else if (rpcType == RpcType::rega) return invokeRega(methodName, parameters);
+
+    if (priority == InvokePriority::low) {
+      waitForDutyCycle(rpcType, methodName);
+      if (_stopped) return BaseLib::Variable::createError(-32500, "CCU is stopped.");
+    }
 
     std::lock_guard<std::mutex> invokeGuard(_invokeMutex);
+    auto connection = getConnection();
+    std::shared_ptr<BaseLib::HttpClient> client;
+    if (rpcType == RpcType::bidcos) client = connection->bidcosClient;
+    else if (rpcType == RpcType::hmip) client = connection->hmipClient;
+    else if (rpcType == RpcType::wired) client = connection->wiredClient;
+    else if (rpcType == RpcType::hmvirtual) client = connection->hmVirtualClient;
+    if (!client) return BaseLib::Variable::createError(-32501, "Interface is disabled.");
 
     std::string path = rpcType == RpcType::hmvirtual ? "/groups" : "/";
     std::string data;
@@ -609,7 +764,7 @@ BaseLib::PVariable Ccu::invoke(Ccu::RpcType rpcType, std::string methodName, Bas
     xmlData.push_back('\r');
     xmlData.push_back('\n');
     std::string header =
-        "POST " + path + " HTTP/1.1\r\nUser-Agent: homegear-ccu\r\nHost: " + _ipAddress + ":" + std::to_string(_port2) + "\r\nContent-Type: text/xml\r\nContent-Length: " + std::to_string(xmlData.size()) + "\r\nConnection: Keep-Alive\r\n\r\n";
+        "POST " + path + " HTTP/1.1\r\nUser-Agent: homegear-ccu\r\nHost: " + connection->ipAddress + ":" + std::to_string(_port2) + "\r\nContent-Type: text/xml\r\nContent-Length: " + std::to_string(xmlData.size()) + "\r\nConnection: Keep-Alive\r\n\r\n";
     data.reserve(header.size() + xmlData.size());
     data.insert(data.end(), header.begin(), header.end());
     data.insert(data.end(), xmlData.begin(), xmlData.end());
@@ -618,10 +773,7 @@ BaseLib::PVariable Ccu::invoke(Ccu::RpcType rpcType, std::string methodName, Bas
     try {
       if (GD::bl->debugLevel >= 5) GD::out.printDebug("Debug: Sending (" + std::to_string((int)rpcType) + ") " + std::string(data.begin(), data.end()));
 
-      if (rpcType == RpcType::bidcos) _bidcosClient->sendRequest(data, httpResponse, false);
-      else if (rpcType == RpcType::hmip) _hmipClient->sendRequest(data, httpResponse, false);
-      else if (rpcType == RpcType::wired) _wiredClient->sendRequest(data, httpResponse, false);
-      else if (rpcType == RpcType::hmvirtual) _hmVirtualClient->sendRequest(data, httpResponse, false);
+      client->sendRequest(data, httpResponse, false);
 
       if (GD::bl->debugLevel >= 5) GD::out.printDebug("Debug: Response was (" + std::to_string((int)rpcType) + ") " + std::string(httpResponse.getContent().data(), httpResponse.getContentSize()));
     }
@@ -640,101 +792,984 @@ BaseLib::PVariable Ccu::invoke(Ccu::RpcType rpcType, std::string methodName, Bas
 
 bool Ccu::regaReady() {
   try {
-    HttpClient client(_bl, _hostname, 80, false);
+    int64_t time = BaseLib::HelperFunctions::getTime();
+    bool ready = _regaReady;
+    if (time - _regaReadyTime < (ready ? _regaReadyTtl : _regaNotReadyTtl)) return ready;
+
+    std::lock_guard<std::mutex> regaCheckGuard(_regaCheckMutex);
+    auto client = getConnection()->regaCheckClient;
     std::string path = "/ise/checkrega.cgi";
     std::string response;
     try {
-      client.get(path, response);
+      client->get(path, response);
+    }
+    catch (BaseLib::HttpClientException &ex) {
+      //The CCU might have closed the keep-alive connection. The client reconnects on the next request, so retry once.
+      try {
+        client->get(path, response);
+      }
+      catch (BaseLib::HttpClientException &ex) {
+        response.clear();
+      }
+    }
+    ready = response == "OK";
+    _regaReady = ready;
+    _regaReadyTime = BaseLib::HelperFunctions::getTime();
+    return ready;
+  }
+  catch (const std::exception &ex) {
+    _out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+  }
+  return false;
+}
+
+void Ccu::regaPost(const std::string &script, std::string &response, bool retry) {
+  std::lock_guard<std::mutex> regaGuard(_regaMutex);
+  auto client = getConnection()->regaClient;
+  try {
+    client->post("/tclrega.exe", script, response);
+  }
+  catch (BaseLib::HttpClientException &ex) {
+    if (!retry) {
+      _regaReadyTime = 0;
+      throw;
+    }
+    //The CCU might have closed the keep-alive connection. The client reconnects on the next request, so retry once.
+    response.clear();
+    try {
+      client->post("/tclrega.exe", script, response);
     }
     catch (BaseLib::HttpClientException &ex) {
+      _regaReadyTime = 0;
+      throw;
+    }
+  }
+}
+
+bool Ccu::executeRegaScripts(const std::vector<std::string> &scripts, std::vector<std::string> &results) {
+  try {
+    results.clear();
+    if (scripts.empty()) return true;
+
+    //The markers contain a random number, so they can't collide with the output of the scripts.
+    std::string markerPrefix = "--homegear-section-" + std::to_string(BaseLib::HelperFunctions::getRandomNumber(100000000, 999999999)) + "-";
+    std::string script;
+    for (size_t i = 0; i < scripts.size(); i++) {
+      script.append("Write(\"" + markerPrefix + std::to_string(i) + "--\");\n");
+      script.append(scripts.at(i));
+      script.append("\n");
+    }
+    script.append("Write(\"" + markerPrefix + "end--\");\n");
+
+    std::string regaResponse;
+    regaPost(script, regaResponse);
+
+    results.reserve(scripts.size());
+    for (size_t i = 0; i < scripts.size(); i++) {
+      std::string marker = markerPrefix + std::to_string(i) + "--";
+      std::string nextMarker = markerPrefix + (i + 1 == scripts.size() ? std::string("end") : std::to_string(i + 1)) + "--";
+      auto start = regaResponse.find(marker);
+      if (start == std::string::npos) break;
+      start += marker.size();
+      auto end = regaResponse.find(nextMarker, start);
+      if (end == std::string::npos) break;
+      results.emplace_back(regaResponse, start, end - start);
+    }
+
+    if (results.size() != scripts.size()) {
+      _out.printWarning("Warning: Could not split output of ReGa script batch.");
+      results.clear();
       return false;
     }
-    if (response == "OK") return true;
+    return true;
   }
   catch (const std::exception &ex) {
     _out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
   }
+  results.clear();
   return false;
 }
 
-std::unordered_map<std::string, std::unordered_map<int32_t, std::string>> Ccu::getNames() {
-  std::unordered_map<std::string, std::unordered_map<int32_t, std::string>> deviceNames;
+void Ccu::loadKnownDevices() {
+  try {
+    std::string settingName = "devicefingerprint-" + _settings->id;
+    auto setting = GD::family->getFamilySetting(settingName);
+    if (!setting || setting->stringValue.empty()) return;
+
+    //Format: One line per address with "RPC_TYPE\tADDRESS\tVERSION\tTYPE".
+    std::lock_guard<std::mutex> knownDevicesGuard(_knownDevicesMutex);
+    _knownDevices.clear();
+    std::istringstream stream(setting->stringValue);
+    std::string line;
+    while (std::getline(stream, line)) {
+      auto fields = BaseLib::HelperFunctions::splitAll(line, '\t');
+      if (fields.size() < 4 || fields.at(1).empty()) continue;
+      KnownDevice knownDevice;
+      knownDevice.version = BaseLib::Math::getNumber(fields.at(2));
+      knownDevice.type = fields.at(3);
+      _knownDevices[(RpcType)BaseLib::Math::getNumber(fields.at(0))][fields.at(1)] = std::move(knownDevice);
+    }
+  }
+  catch (const std::exception &ex) {
+    _out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+  }
+}
+
+void Ccu::saveKnownDevices() {
+  try {
+    std::string fingerprint;
+    {
+      std::lock_guard<std::mutex> knownDevicesGuard(_knownDevicesMutex);
+      for (auto &rpcTypeElement : _knownDevices) {
+        for (auto &device : rpcTypeElement.second) {
+          fingerprint.append(std::to_string((int32_t)rpcTypeElement.first) + "\t" + device.first + "\t" + std::to_string(device.second.version) + "\t" + device.second.type + "\n");
+        }
+      }
+    }
+
+    std::string settingName = "devicefingerprint-" + _settings->id;
+    GD::family->setFamilySetting(settingName, fingerprint);
+  }
+  catch (const std::exception &ex) {
+    _out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+  }
+}
+
+bool Ccu::filterEvent(RpcType rpcType, const BaseLib::PArray &parameters, const PMyPacket &packet) {
+  try {
+    if (_eventFilter.empty() || parameters->size() < 4) return true;
+
+    const std::string &address = parameters->at(1)->stringValue;
+    auto action = _eventFilter.getAction(address, parameters->at(2)->stringValue, [&]() {
+      std::lock_guard<std::mutex> knownDevicesGuard(_knownDevicesMutex);
+      auto &knownDevices = _knownDevices[rpcType];
+      auto knownDeviceIterator = knownDevices.find(address.substr(0, address.find(':')));
+      return knownDeviceIterator == knownDevices.end() ? std::string() : knownDeviceIterator->second.type;
+    });
+    if (action == EventFilter::Action::drop) {
+      if (_bl->debugLevel >= 5) _out.printDebug("Debug: Dropping event of " + address + " " + parameters->at(2)->stringValue + ".");
+      return false;
+    }
+    packet->setFilterAction(action);
+  }
+  catch (const std::exception &ex) {
+    _out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+  }
+  return true;
+}
+
+void Ccu::updateBidcosDutyCycle() {
+  try {
+    auto result = invoke(RpcType::bidcos, "listBidcosInterfaces", std::make_shared<BaseLib::Array>());
+    if (result->errorStruct) {
+      _out.printWarning("Warning: Could not call \"listBidcosInterfaces\": " + result->structValue->at("faultString")->stringValue);
+      return;
+    }
+
+    DutyCycle dutyCycle;
+    for (auto &interface : *result->arrayValue) {
+      auto connectedIterator = interface->structValue->find("CONNECTED");
+      if (connectedIterator != interface->structValue->end() && !connectedIterator->second->booleanValue) continue;
+      auto valueIterator = interface->structValue->find("DUTY_CYCLE");
+      if (valueIterator != interface->structValue->end() && valueIterator->second->integerValue > dutyCycle.dutyCycle) dutyCycle.dutyCycle = valueIterator->second->integerValue;
+      valueIterator = interface->structValue->find("CARRIER_SENSE");
+      if (valueIterator != interface->structValue->end() && valueIterator->second->integerValue > dutyCycle.carrierSense) dutyCycle.carrierSense = valueIterator->second->integerValue;
+    }
+    dutyCycle.time = BaseLib::HelperFunctions::getTime();
+
+    {
+      std::lock_guard<std::mutex> dutyCycleGuard(_dutyCycleMutex);
+      _dutyCycleBidcos = dutyCycle;
+    }
+    _dutyCycleConditionVariable.notify_all();
+    if (_bl->debugLevel >= 5) _out.printDebug("Debug: BidCoS duty cycle is " + std::to_string(dutyCycle.dutyCycle) + " %.");
+  }
+  catch (const std::exception &ex) {
+    _out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+  }
+}
+
+void Ccu::dutyCycleEvent(RpcType rpcType, const BaseLib::PArray &parameters) {
+  try {
+    if (rpcType != RpcType::hmip || parameters->size() < 4) return;
+    const std::string &name = parameters->at(2)->stringValue;
+    bool isDutyCycle = name == "DUTY_CYCLE_LEVEL";
+    if (!isDutyCycle && name != "CARRIER_SENSE_LEVEL") return;
+
+    auto &value = parameters->at(3);
+    int32_t level = value->type == BaseLib::VariableType::tFloat ? std::lround(value->floatValue) : value->integerValue;
+    {
+      std::lock_guard<std::mutex> dutyCycleGuard(_dutyCycleMutex);
+      if (isDutyCycle) _dutyCycleHmip.dutyCycle = level;
+      else _dutyCycleHmip.carrierSense = level;
+      _dutyCycleHmip.time = BaseLib::HelperFunctions::getTime();
+    }
+    _dutyCycleConditionVariable.notify_all();
+  }
+  catch (const std::exception &ex) {
+    _out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+  }
+}
+
+Ccu::DutyCycle Ccu::getDutyCycle(RpcType rpcType) {
+  std::lock_guard<std::mutex> dutyCycleGuard(_dutyCycleMutex);
+  if (rpcType == RpcType::bidcos) return _dutyCycleBidcos;
+  else if (rpcType == RpcType::hmip) return _dutyCycleHmip;
+  return DutyCycle();
+}
+
+void Ccu::waitForDutyCycle(RpcType rpcType, const std::string &methodName) {
+  try {
+    if (rpcType != RpcType::bidcos && rpcType != RpcType::hmip) return;
+
+    std::unique_lock<std::mutex> dutyCycleGuard(_dutyCycleMutex);
+    auto &dutyCycle = rpcType == RpcType::bidcos ? _dutyCycleBidcos : _dutyCycleHmip;
+    if (dutyCycle.dutyCycle < _dutyCycleThreshold) return;
+
+    _out.printInfo("Info: Duty cycle is at " + std::to_string(dutyCycle.dutyCycle) + " %. Deferring call to \"" + methodName + "\".");
+    _deferredInvokes++;
+    bool belowThreshold = _dutyCycleConditionVariable.wait_for(dutyCycleGuard, std::chrono::milliseconds(_maxDeferral), [&] {
+      return _stopped || dutyCycle.dutyCycle < _dutyCycleThreshold;
+    });
+    _deferredInvokes--;
+    if (!belowThreshold) _out.printWarning("Warning: Duty cycle is still at " + std::to_string(dutyCycle.dutyCycle) + " %. Calling \"" + methodName + "\" anyway.");
+  }
+  catch (const std::exception &ex) {
+    _out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+  }
+}
+
+size_t Ccu::addKnownDevices(RpcType rpcType, const BaseLib::PVariable &descriptions) {
+  try {
+    size_t deviceCount = 0;
+    bool changed = false;
+    {
+      std::lock_guard<std::mutex> knownDevicesGuard(_knownDevicesMutex);
+      auto &knownDevices = _knownDevices[rpcType];
+      for (auto &description : *descriptions->arrayValue) {
+        auto addressIterator = description->structValue->find("ADDRESS");
+        if (addressIterator == description->structValue->end() || addressIterator->second->stringValue.empty()) continue;
+
+        KnownDevice knownDevice;
+        auto versionIterator = description->structValue->find("VERSION");
+        if (versionIterator != description->structValue->end()) knownDevice.version = versionIterator->second->integerValue;
+        auto typeIterator = description->structValue->find("TYPE");
+        if (typeIterator != description->structValue->end()) knownDevice.type = typeIterator->second->stringValue;
+
+        auto knownDeviceIterator = knownDevices.find(addressIterator->second->stringValue);
+        if (knownDeviceIterator != knownDevices.end() && knownDeviceIterator->second.version == knownDevice.version && knownDeviceIterator->second.type == knownDevice.type) continue;
+        knownDevices[addressIterator->second->stringValue] = std::move(knownDevice);
+        changed = true;
+      }
+      deviceCount = knownDevices.size();
+    }
+    if (changed) {
+      saveKnownDevices();
+      _eventFilter.clearCache();
+    }
+    return deviceCount;
+  }
+  catch (const std::exception &ex) {
+    _out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+  }
+  return 0;
+}
+
+void Ccu::removeKnownDevices(RpcType rpcType, const BaseLib::PVariable &addresses) {
+  try {
+    bool changed = false;
+    {
+      std::lock_guard<std::mutex> knownDevicesGuard(_knownDevicesMutex);
+      auto &knownDevices = _knownDevices[rpcType];
+      for (auto &address : *addresses->arrayValue) {
+        if (knownDevices.erase(address->stringValue) > 0) changed = true;
+      }
+    }
+    if (changed) {
+      saveKnownDevices();
+      _eventFilter.clearCache();
+    }
+  }
+  catch (const std::exception &ex) {
+    _out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+  }
+}
+
+BaseLib::PVariable Ccu::getKnownDevices(RpcType rpcType) {
+  auto devices = std::make_shared<BaseLib::Variable>(BaseLib::VariableType::tArray);
+  try {
+    std::lock_guard<std::mutex> knownDevicesGuard(_knownDevicesMutex);
+    auto knownDevicesIterator = _knownDevices.find(rpcType);
+    if (knownDevicesIterator == _knownDevices.end()) return devices;
+    devices->arrayValue->reserve(knownDevicesIterator->second.size());
+    for (auto &knownDevice : knownDevicesIterator->second) {
+      auto device = std::make_shared<BaseLib::Variable>(BaseLib::VariableType::tStruct);
+      device->structValue->emplace("ADDRESS", std::make_shared<BaseLib::Variable>(knownDevice.first));
+      device->structValue->emplace("VERSION", std::make_shared<BaseLib::Variable>(knownDevice.second.version));
+      devices->arrayValue->emplace_back(std::move(device));
+    }
+  }
+  catch (const std::exception &ex) {
+    _out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+  }
+  return devices;
+}
+
+std::shared_ptr<const Ccu::DeviceNames> Ccu::getNames() {
+  try {
+    //Only one caller loads the names. All others wait for it and then get the freshly loaded names.
+    std::lock_guard<std::mutex> namesLoadGuard(_namesLoadMutex);
+    std::shared_ptr<const DeviceNames> names;
+    int64_t since = 0;
+    {
+      std::lock_guard<std::mutex> namesGuard(_namesMutex);
+      if (_names && BaseLib::HelperFunctions::getTime() - _namesLastRefresh < _namesRefreshInterval) return _names;
+      names = _names;
+      if (names) since = _namesRegaTime;
+    }
+
+    DeviceNames changedNames;
+    int64_t regaTime = 0;
+    if (!queryNames("", since, changedNames, regaTime)) return names ? names : std::make_shared<const DeviceNames>();
+
+    return storeNames(names, since, changedNames, regaTime);
+  }
+  catch (const std::exception &ex) {
+    _out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+  }
+  return std::make_shared<const DeviceNames>();
+}
+
+std::shared_ptr<const Ccu::DeviceNames> Ccu::storeNames(const std::shared_ptr<const DeviceNames> &names, int64_t since, DeviceNames &changedNames, int64_t regaTime) {
+  std::shared_ptr<DeviceNames> newNames = names ? std::make_shared<DeviceNames>(*names) : std::make_shared<DeviceNames>();
+  for (auto &deviceNames : changedNames) {
+    (*newNames)[deviceNames.first] = std::move(deviceNames.second);
+  }
+  if (since != 0 && !changedNames.empty()) _out.printInfo("Info: Names of " + std::to_string(changedNames.size()) + " devices changed.");
+
+  std::lock_guard<std::mutex> namesGuard(_namesMutex);
+  _names = newNames;
+  _namesLastRefresh = BaseLib::HelperFunctions::getTime();
+  //Subtract one second, so changes within the same second as the query are not lost.
+  if (regaTime > 0) _namesRegaTime = regaTime - 1;
+  return _names;
+}
+
+std::unordered_map<int32_t, std::string> Ccu::getNames(const std::string &serialNumber) {
+  try {
+    DeviceNames deviceNames;
+    int64_t regaTime = 0;
+    if (!queryNames(serialNumber, 0, deviceNames, regaTime)) return std::unordered_map<int32_t, std::string>();
+    auto deviceNamesIterator = deviceNames.find(serialNumber);
+    if (deviceNamesIterator == deviceNames.end()) return std::unordered_map<int32_t, std::string>();
+
+    {
+      std::lock_guard<std::mutex> namesGuard(_namesMutex);
+      if (_names) {
+        auto newNames = std::make_shared<DeviceNames>(*_names);
+        (*newNames)[serialNumber] = deviceNamesIterator->second;
+        _names = newNames;
+      }
+    }
+
+    return deviceNamesIterator->second;
+  }
+  catch (const std::exception &ex) {
+    _out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+  }
+  return std::unordered_map<int32_t, std::string>();
+}
+
+bool Ccu::queryNames(const std::string &serialNumber, int64_t since, DeviceNames &deviceNames, int64_t &regaTime) {
+  try {
+    std::string regaResponse;
+    regaPost(getNamesScript(serialNumber, since), regaResponse);
+    return parseNames(regaResponse, deviceNames, regaTime);
+  }
+  catch (const std::exception &ex) {
+    _out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+  }
+  return false;
+}
+
+std::string Ccu::getNamesScript(const std::string &serialNumber, int64_t since) {
+  std::string address = serialNumber;
+  BaseLib::HelperFunctions::stripNonAlphaNumeric(address);
+  std::string script = _getNamesScript;
+  BaseLib::HelperFunctions::stringReplace(script, "%ADDRESS%", address);
+  BaseLib::HelperFunctions::stringReplace(script, "%SINCE%", std::to_string(since));
+  return script;
+}
+
+bool Ccu::parseNames(const std::string &response, DeviceNames &deviceNames, int64_t &regaTime) {
+  try {
+    BaseLib::Ansi ansi(true, false);
+    std::string deviceAddress;
+    std::string deviceName;
+    std::string channelAddress;
+    std::string channelName;
+    RegaJsonParser parser([&](uint32_t depth, const std::string &key, std::string &value) {
+      //Depth 1: {"Time", "Devices"}, depth 3: device objects, depth 5: channel objects
+      if (depth == 1) {
+        if (key == "Time") regaTime = BaseLib::Math::getNumber64(value);
+        return;
+      }
+      if (std::any_of(value.begin(), value.end(), [](char c) { return (uint8_t)c >= 0x80; })) value = ansi.toUtf8(value);
+      if (depth == 3) {
+        if (key == "Address") deviceAddress.swap(value);
+        else if (key == "Name") deviceName.swap(value);
+      } else if (depth == 5) {
+        if (key == "Address") channelAddress.swap(value);
+        else if (key == "ChannelName") channelName.swap(value);
+      }
+    }, [&](uint32_t depth, const std::string &key) {
+      if (depth == 3) {
+        deviceAddress.clear();
+        deviceName.clear();
+      } else if (depth == 5) {
+        channelAddress.clear();
+        channelName.clear();
+      }
+    }, [&](uint32_t depth, const std::string &key) {
+      if (depth == 3) {
+        if (!deviceAddress.empty()) deviceNames[deviceAddress][-1] = deviceName;
+      } else if (depth == 5) {
+        auto addressPair = BaseLib::HelperFunctions::splitLast(channelAddress, ':');
+        if (addressPair.first.empty() || addressPair.second.empty()) return;
+        deviceNames[addressPair.first][BaseLib::Math::getNumber(addressPair.second)] = channelName;
+      }
+    });
+
+    if (!parser.feed(response) || !parser.finished()) {
+      _out.printWarning("Warning: Could not parse names returned by ReGa.");
+      return false;
+    }
+    return true;
+  }
+  catch (const std::exception &ex) {
+    _out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+  }
+  return false;
+}
+
+bool Ccu::getDatapointValues(const std::function<void(const std::string &address, const std::string &name, const std::string &value, int64_t timestamp)> &callback) {
   try {
     BaseLib::Ansi ansi(true, false);
     std::string regaResponse;
-    _httpClient->post("/tclrega.exe", _getNamesScript, regaResponse);
-    BaseLib::Rpc::JsonDecoder jsonDecoder(_bl);
-    auto namesJson = jsonDecoder.decode(regaResponse);
-    auto devicesIterator = namesJson->structValue->find("Devices");
-    if (devicesIterator != namesJson->structValue->end()) namesJson = devicesIterator->second;
-    for (auto &nameElement: *namesJson->arrayValue) {
-      auto addressIterator = nameElement->structValue->find("Address");
-      auto nameIterator = nameElement->structValue->find("Name");
-      if (addressIterator == nameElement->structValue->end() || nameIterator == nameElement->structValue->end()) continue;
+    //ReGa writes its time when the script starts, which is close to when the request is sent.
+    int64_t localTime = BaseLib::HelperFunctions::getTime();
+    regaPost(_getDatapointValuesScript, regaResponse);
+
+    //The first line is the time of ReGa in seconds. It is used to convert the timestamps to the local clock.
+    size_t lineStart = regaResponse.find('\n');
+    if (lineStart == std::string::npos) return false;
+    int64_t regaTime = BaseLib::Math::getNumber64(regaResponse.substr(0, lineStart));
+    if (regaTime <= 0) return false;
+    lineStart++;
+
+    //Every other line has the format "INTERFACE.SERIAL:CHANNEL.PARAMETER\tVALUE\tTIMESTAMP". ReGa appends an XML block, which is skipped as it doesn't
+    //match.
+    std::string address;
+    std::string name;
+    std::string value;
+    while (lineStart < regaResponse.size()) {
+      size_t lineEnd = regaResponse.find('\n', lineStart);
+      if (lineEnd == std::string::npos) lineEnd = regaResponse.size();
+
+      size_t firstTab = regaResponse.find('\t', lineStart);
+      size_t lastTab = regaResponse.rfind('\t', lineEnd - 1);
+      if (firstTab != std::string::npos && lastTab != std::string::npos && firstTab < lastTab && lastTab < lineEnd) {
+        size_t interfaceEnd = regaResponse.find('.', lineStart);
+        size_t addressEnd = regaResponse.rfind('.', firstTab);
+        if (interfaceEnd != std::string::npos && addressEnd != std::string::npos && interfaceEnd < addressEnd) {
+          address.assign(regaResponse, interfaceEnd + 1, addressEnd - interfaceEnd - 1);
+          name.assign(regaResponse, addressEnd + 1, firstTab - addressEnd - 1);
+          value.assign(regaResponse, firstTab + 1, lastTab - firstTab - 1);
+          if (std::any_of(value.begin(), value.end(), [](char c) { return (uint8_t)c >= 0x80; })) value = ansi.toUtf8(value);
+          int64_t timestamp = localTime - (regaTime - BaseLib::Math::getNumber64(regaResponse.substr(lastTab + 1, lineEnd - lastTab - 1))) * 1000;
+          if (!address.empty() && !name.empty()) callback(address, name, value, timestamp);
+        }
+      }
+
+      lineStart = lineEnd + 1;
+    }
+    return true;
+  }
+  catch (const std::exception &ex) {
+    _out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+  }
+  return false;
+}
+
+void Ccu::pollRega() {
+  try {
+    auto previousMessages = getServiceMessages();
+    std::shared_ptr<ServiceMessages> serviceMessages;
+    if (_nativeServiceMessageErrors < _maxNativeServiceMessageErrors) {
+      serviceMessages = getNativeServiceMessages(previousMessages);
+      if (serviceMessages) _nativeServiceMessageErrors = 0;
+      else if (++_nativeServiceMessageErrors == _maxNativeServiceMessageErrors) _out.printInfo("Info: \"getServiceMessages\" failed repeatedly. Using ReGa to get service messages.");
+    }
+
+    std::vector<std::string> scripts;
+    int32_t serviceMessagesIndex = -1;
+    if (!serviceMessages) {
+      serviceMessagesIndex = scripts.size();
+      scripts.push_back(_getServiceMessagesScript);
+    }
+
+    //Refresh the names in the same request when they were loaded before and are stale. Skip it when another thread is loading them right now.
+    int32_t namesIndex = -1;
+    std::shared_ptr<const DeviceNames> names;
+    int64_t namesSince = 0;
+    std::unique_lock<std::mutex> namesLoadGuard(_namesLoadMutex, std::try_to_lock);
+    if (namesLoadGuard.owns_lock()) {
+      std::lock_guard<std::mutex> namesGuard(_namesMutex);
+      if (_names && BaseLib::HelperFunctions::getTime() - _namesLastRefresh >= _namesRefreshInterval) {
+        names = _names;
+        namesSince = _namesRegaTime;
+        namesIndex = scripts.size();
+        scripts.push_back(getNamesScript("", namesSince));
+      }
+    }
+
+    int64_t systemVariablesSince = _systemVariablesRegaTime;
+    int32_t systemVariablesIndex = scripts.size();
+    std::string systemVariablesScript = _getSystemVariablesScript;
+    BaseLib::HelperFunctions::stringReplace(systemVariablesScript, "%SINCE%", std::to_string(systemVariablesSince));
+    scripts.push_back(systemVariablesScript);
 
-      nameIterator->second->stringValue = ansi.toUtf8(nameIterator->second->stringValue);
-      deviceNames[addressIterator->second->stringValue][-1] = nameIterator->second->stringValue;
+    std::vector<std::string> results;
+    if (!executeRegaScripts(scripts, results)) {
+      if (serviceMessages) updateServiceMessages(previousMessages, serviceMessages);
+      return;
+    }
+
+    if (namesIndex != -1) {
+      DeviceNames changedNames;
+      int64_t regaTime = 0;
+      if (parseNames(results.at(namesIndex), changedNames, regaTime)) storeNames(names, namesSince, changedNames, regaTime);
+    }
+    if (namesLoadGuard.owns_lock()) namesLoadGuard.unlock();
 
-      auto channelsIterator = nameElement->structValue->find("Channels");
-      if (channelsIterator == nameElement->structValue->end()) continue;
+    if (serviceMessagesIndex != -1) serviceMessages = parseRegaServiceMessages(results.at(serviceMessagesIndex));
+    if (serviceMessages) updateServiceMessages(previousMessages, serviceMessages);
 
-      for (auto &channelElement: *channelsIterator->second->arrayValue) {
-        auto channelIterator = channelElement->structValue->find("Address");
-        auto channelNameIterator = channelElement->structValue->find("ChannelName");
-        if (channelIterator == channelElement->structValue->end() || channelNameIterator == channelElement->structValue->end()) continue;
+    std::vector<SystemVariable> systemVariables;
+    int64_t regaTime = 0;
+    int32_t count = 0;
+    if (parseSystemVariables(results.at(systemVariablesIndex), systemVariables, regaTime, count)) updateSystemVariables(systemVariables, systemVariablesSince == 0, count, regaTime);
+  }
+  catch (const std::exception &ex) {
+    _out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+  }
+}
 
-        auto addressPair = BaseLib::HelperFunctions::splitLast(channelIterator->second->stringValue, ':');
-        if (addressPair.second.empty()) continue;
-        int32_t channel = BaseLib::Math::getNumber(addressPair.second);
+void Ccu::updateServiceMessages(const std::shared_ptr<const ServiceMessages> &previousMessages, const std::shared_ptr<ServiceMessages> &serviceMessages) {
+  try {
+    std::unordered_map<std::string, std::shared_ptr<const CcuServiceMessage>> previousMessagesByKey;
+    previousMessagesByKey.reserve(previousMessages->size());
+    for (auto &serviceMessage : *previousMessages) {
+      previousMessagesByKey.emplace(serviceMessage->serial + "." + serviceMessage->message, serviceMessage);
+    }
 
-        deviceNames[addressIterator->second->stringValue][channel] = ansi.toUtf8(channelNameIterator->second->stringValue);
+    auto changes = std::make_shared<BaseLib::Variable>(BaseLib::VariableType::tArray);
+    for (auto &serviceMessage : *serviceMessages) {
+      auto previousMessageIterator = previousMessagesByKey.find(serviceMessage->serial + "." + serviceMessage->message);
+      if (previousMessageIterator != previousMessagesByKey.end()) {
+        bool changed = previousMessageIterator->second->value != serviceMessage->value;
+        previousMessagesByKey.erase(previousMessageIterator);
+        if (!changed) continue;
       }
+      auto change = std::make_shared<BaseLib::Variable>(BaseLib::VariableType::tArray);
+      change->arrayValue->reserve(3);
+      change->arrayValue->push_back(std::make_shared<BaseLib::Variable>(serviceMessage->serial));
+      change->arrayValue->push_back(std::make_shared<BaseLib::Variable>(serviceMessage->message));
+      change->arrayValue->push_back(std::make_shared<BaseLib::Variable>(serviceMessage->value));
+      changes->arrayValue->push_back(change);
+    }
+    //All remaining previous messages are not set anymore.
+    for (auto &previousMessage : previousMessagesByKey) {
+      if (!previousMessage.second->value) continue;
+      auto change = std::make_shared<BaseLib::Variable>(BaseLib::VariableType::tArray);
+      change->arrayValue->reserve(3);
+      change->arrayValue->push_back(std::make_shared<BaseLib::Variable>(previousMessage.second->serial));
+      change->arrayValue->push_back(std::make_shared<BaseLib::Variable>(previousMessage.second->message));
+      change->arrayValue->push_back(std::make_shared<BaseLib::Variable>(false));
+      changes->arrayValue->push_back(change);
     }
+
+    if (changes->arrayValue->empty()) return;
+    std::atomic_store(&_serviceMessages, std::shared_ptr<const ServiceMessages>(serviceMessages));
+
+    auto parameters = std::make_shared<BaseLib::Array>();
+    parameters->push_back(changes);
+    PMyPacket packet = std::make_shared<MyPacket>("homegear.serviceMessagesChanged", parameters);
+    raisePacketReceived(packet);
   }
   catch (const std::exception &ex) {
-    GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+    _out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
   }
-  return deviceNames;
 }
 
-void Ccu::getCcuServiceMessages() {
+bool Ccu::parseSystemVariables(const std::string &response, std::vector<SystemVariable> &systemVariables, int64_t &regaTime, int32_t &count) {
   try {
     BaseLib::Ansi ansi(true, false);
-    std::string regaResponse;
-    _httpClient->post("/tclrega.exe", _getServiceMessagesScript, regaResponse);
-    BaseLib::Rpc::JsonDecoder jsonDecoder(_bl);
-    auto serviceMessagesJson = jsonDecoder.decode(regaResponse);
-
-    std::lock_guard<std::mutex> serviceMessagesGuard(_serviceMessagesMutex);
-    _serviceMessages.clear();
-
-    auto serviceMessagesIterator = serviceMessagesJson->structValue->find("serviceMessages");
-    if (serviceMessagesIterator != serviceMessagesJson->structValue->end()) {
-      _serviceMessages.reserve(serviceMessagesIterator->second->arrayValue->size());
-      for (auto &serviceMessageElement: *serviceMessagesIterator->second->arrayValue) {
-        auto addressIterator = serviceMessageElement->structValue->find("address");
-        auto stateIterator = serviceMessageElement->structValue->find("state");
-        auto messageIterator = serviceMessageElement->structValue->find("message");
-        auto timeIterator = serviceMessageElement->structValue->find("time");
-
-        if (addressIterator == serviceMessageElement->structValue->end() || stateIterator == serviceMessageElement->structValue->end() || messageIterator == serviceMessageElement->structValue->end()
-            || timeIterator == serviceMessageElement->structValue->end()) {
-          continue;
+    size_t position = 0;
+    auto readField = [&](char delimiter, std::string &field) {
+      size_t end = response.find(delimiter, position);
+      if (end == std::string::npos) return false;
+      field = response.substr(position, end - position);
+      position = end + 1;
+      return true;
+    };
+    //Strings are written as "\tLENGTH:STRING" and are not terminated, as they may contain any character.
+    auto readString = [&](std::string &field) {
+      if (position >= response.size() || response.at(position) != '\t') return false;
+      position++;
+      std::string length;
+      if (!readField(':', length)) return false;
+      int32_t size = BaseLib::Math::getNumber(length);
+      if (size < 0 || position + size > response.size()) return false;
+      field = response.substr(position, size);
+      position += size;
+      if (std::any_of(field.begin(), field.end(), [](char c) { return (uint8_t)c >= 0x80; })) field = ansi.toUtf8(field);
+      return true;
+    };
+
+    std::string field;
+    if (!readField('\n', field)) {
+      _out.printWarning("Warning: Could not parse system variables returned by ReGa.");
+      return false;
+    }
+    regaTime = BaseLib::Math::getNumber64(field);
+
+    while (position < response.size()) {
+      if (response.compare(position, 6, "Count\t") == 0) {
+        count = BaseLib::Math::getNumber(response.substr(position + 6));
+        return true;
+      }
+
+      SystemVariable systemVariable;
+      if (!readField('\t', field)) break;
+      systemVariable.id = BaseLib::Math::getNumber(field);
+      if (!readField('\t', field)) break;
+      systemVariable.valueType = BaseLib::Math::getNumber(field);
+      size_t subTypeEnd = response.find('\t', position);
+      if (subTypeEnd == std::string::npos) break;
+      systemVariable.valueSubType = BaseLib::Math::getNumber(response.substr(position, subTypeEnd - position));
+      position = subTypeEnd;
+      if (!readString(systemVariable.name) || !readString(systemVariable.value) || !readString(systemVariable.valueList) || !readString(systemVariable.minimum)
+          || !readString(systemVariable.maximum) || !readString(systemVariable.unit)) {
+        break;
+      }
+      if (position >= response.size() || response.at(position) != '\n') break;
+      position++;
+      if (systemVariable.id != 0 && !systemVariable.name.empty()) systemVariables.push_back(std::move(systemVariable));
+    }
+
+    _out.printWarning("Warning: Could not parse system variables returned by ReGa.");
+    return false;
+  }
+  catch (const std::exception &ex) {
+    _out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+  }
+  return false;
+}
+
+void Ccu::updateSystemVariables(std::vector<SystemVariable> &systemVariables, bool full, int32_t count, int64_t regaTime) {
+  try {
+    auto sameDefinition = [](const SystemVariable &a, const SystemVariable &b) {
+      return a.name == b.name && a.valueType == b.valueType && a.valueSubType == b.valueSubType && a.valueList == b.valueList && a.minimum == b.minimum && a.maximum == b.maximum
+          && a.unit == b.unit;
+    };
+
+    auto values = std::make_shared<BaseLib::Variable>(BaseLib::VariableType::tStruct);
+    auto description = std::make_shared<BaseLib::Variable>(BaseLib::VariableType::tStruct);
+    int32_t version = 0;
+    {
+      std::lock_guard<std::mutex> systemVariablesGuard(_systemVariablesMutex);
+      bool structureChanged = false;
+      if (full) {
+        std::map<int32_t, SystemVariable> newSystemVariables;
+        for (auto &systemVariable : systemVariables) {
+          newSystemVariables.emplace(systemVariable.id, systemVariable);
+        }
+        structureChanged = newSystemVariables.size() != _systemVariables.size();
+        for (auto &systemVariable : newSystemVariables) {
+          if (structureChanged) break;
+          auto systemVariableIterator = _systemVariables.find(systemVariable.first);
+          structureChanged = systemVariableIterator == _systemVariables.end() || !sameDefinition(systemVariableIterator->second, systemVariable.second);
+        }
+        _systemVariables.swap(newSystemVariables);
+        _systemVariableIdsByName.clear();
+        for (auto &systemVariable : _systemVariables) {
+          _systemVariableIdsByName.emplace(systemVariable.second.name, systemVariable.first);
+          values->structValue->emplace(systemVariable.second.name, getSystemVariableValue(systemVariable.second));
+        }
+      } else {
+        for (auto &systemVariable : systemVariables) {
+          auto systemVariableIterator = _systemVariables.find(systemVariable.id);
+          if (systemVariableIterator == _systemVariables.end()) structureChanged = true;
+          else if (!sameDefinition(systemVariableIterator->second, systemVariable)) {
+            structureChanged = true;
+            _systemVariableIdsByName.erase(systemVariableIterator->second.name);
+          }
+          _systemVariableIdsByName[systemVariable.name] = systemVariable.id;
+          values->structValue->emplace(systemVariable.name, getSystemVariableValue(systemVariable));
+          _systemVariables[systemVariable.id] = std::move(systemVariable);
+        }
+      }
+
+      //Every full poll sends the description, so the peer is created if it doesn't exist yet. The central skips it when the version is unchanged.
+      if (full || structureChanged) description = getSystemVariablesDescription(version);
+
+      if ((int32_t)_systemVariables.size() != count) {
+        //System variables were deleted. Do a full poll next time.
+        _systemVariablesRegaTime = 0;
+      } else if (regaTime > 0) {
+        //Subtract one second, so changes within the same second as the query are not lost.
+        _systemVariablesRegaTime = regaTime - 1;
+      }
+    }
+
+    if (values->structValue->empty() && description->structValue->empty()) return;
+
+    auto parameters = std::make_shared<BaseLib::Array>();
+    parameters->reserve(3);
+    parameters->push_back(values);
+    parameters->push_back(description);
+    parameters->push_back(std::make_shared<BaseLib::Variable>(version));
+    PMyPacket packet = std::make_shared<MyPacket>("homegear.systemVariables", parameters);
+    raisePacketReceived(packet);
+  }
+  catch (const std::exception &ex) {
+    _out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+  }
+}
+
+BaseLib::PVariable Ccu::getSystemVariableValue(const SystemVariable &systemVariable) {
+  //ReGa value types: 2 = binary, 4 = float, 16 = integer (value subtype 29 = enumeration), 20 = string
+  if (systemVariable.valueType == 2) return std::make_shared<BaseLib::Variable>(systemVariable.value == "true");
+  else if (systemVariable.valueType == 4) return std::make_shared<BaseLib::Variable>(BaseLib::Math::getDouble(systemVariable.value));
+  else if (systemVariable.valueType == 16) return std::make_shared<BaseLib::Variable>(BaseLib::Math::getNumber(systemVariable.value));
+  return std::make_shared<BaseLib::Variable>(systemVariable.value);
+}
+
+BaseLib::PVariable Ccu::getSystemVariablesDescription(int32_t &version) {
+  auto description = std::make_shared<BaseLib::Variable>(BaseLib::VariableType::tStruct);
+  std::string fingerprint;
+  for (auto &element : _systemVariables) {
+    auto &systemVariable = element.second;
+    fingerprint.append(systemVariable.name + '\t' + std::to_string(systemVariable.valueType) + '\t' + std::to_string(systemVariable.valueSubType) + '\t' + systemVariable.valueList + '\t'
+                           + systemVariable.minimum + '\t' + systemVariable.maximum + '\t' + systemVariable.unit + '\n');
+
+    auto parameter = std::make_shared<BaseLib::Variable>(BaseLib::VariableType::tStruct);
+    parameter->structValue->emplace("OPERATIONS", std::make_shared<BaseLib::Variable>(7));
+    parameter->structValue->emplace("FLAGS", std::make_shared<BaseLib::Variable>(1));
+    if (systemVariable.valueType == 2) {
+      parameter->structValue->emplace("TYPE", std::make_shared<BaseLib::Variable>(std::string("BOOL")));
+    } else if (systemVariable.valueType == 4) {
+      parameter->structValue->emplace("TYPE", std::make_shared<BaseLib::Variable>(std::string("FLOAT")));
+      parameter->structValue->emplace("MIN", std::make_shared<BaseLib::Variable>(BaseLib::Math::getDouble(systemVariable.minimum)));
+      parameter->structValue->emplace("MAX", std::make_shared<BaseLib::Variable>(BaseLib::Math::getDouble(systemVariable.maximum)));
+      parameter->structValue->emplace("UNIT", std::make_shared<BaseLib::Variable>(systemVariable.unit));
+    } else if (systemVariable.valueType == 16 && systemVariable.valueSubType == 29) {
+      auto valueList = std::make_shared<BaseLib::Variable>(BaseLib::VariableType::tArray);
+      for (auto &value : BaseLib::HelperFunctions::splitAll(systemVariable.valueList, ';')) {
+        valueList->arrayValue->push_back(std::make_shared<BaseLib::Variable>(value));
+      }
+      parameter->structValue->emplace("TYPE", std::make_shared<BaseLib::Variable>(std::string("ENUM")));
+      parameter->structValue->emplace("MIN", std::make_shared<BaseLib::Variable>(0));
+      parameter->structValue->emplace("MAX", std::make_shared<BaseLib::Variable>((int32_t)valueList->arrayValue->size() - 1));
+      parameter->structValue->emplace("VALUE_LIST", valueList);
+    } else if (systemVariable.valueType == 16) {
+      parameter->structValue->emplace("TYPE", std::make_shared<BaseLib::Variable>(std::string("INTEGER")));
+      parameter->structValue->emplace("MIN", std::make_shared<BaseLib::Variable>(BaseLib::Math::getNumber(systemVariable.minimum)));
+      parameter->structValue->emplace("MAX", std::make_shared<BaseLib::Variable>(BaseLib::Math::getNumber(systemVariable.maximum)));
+      parameter->structValue->emplace("UNIT", std::make_shared<BaseLib::Variable>(systemVariable.unit));
+    } else {
+      parameter->structValue->emplace("TYPE", std::make_shared<BaseLib::Variable>(std::string("STRING")));
+    }
+    description->structValue->emplace(systemVariable.name, parameter);
+  }
+  version = (int32_t)(std::hash<std::string>()(fingerprint) & 0x7FFFFFFF);
+  return description;
+}
+
+BaseLib::PVariable Ccu::setSystemVariables(const BaseLib::PVariable &values) {
+  try {
+    BaseLib::Ansi ansi(false, true);
+    std::string script;
+    std::vector<std::pair<int32_t, std::string>> newValues;
+    newValues.reserve(values->structValue->size());
+    {
+      std::lock_guard<std::mutex> systemVariablesGuard(_systemVariablesMutex);
+      for (auto &value : *values->structValue) {
+        auto idIterator = _systemVariableIdsByName.find(value.first);
+        if (idIterator == _systemVariableIdsByName.end()) return BaseLib::Variable::createError(-5, "Unknown system variable: " + value.first);
+        auto &systemVariable = _systemVariables.at(idIterator->second);
+
+        std::string newValue;
+        std::string regaValue;
+        if (systemVariable.valueType == 2) newValue = regaValue = value.second->booleanValue ? "true" : "false";
+        else if (systemVariable.valueType == 4) newValue = regaValue = std::to_string(value.second->type == BaseLib::VariableType::tFloat ? value.second->floatValue : (double)value.second->integerValue);
+        else if (systemVariable.valueType == 16) newValue = regaValue = std::to_string(value.second->integerValue);
+        else {
+          newValue = value.second->stringValue;
+          //ReGa has no escape sequences, so choose the quote character not contained in the string.
+          regaValue = ansi.toAnsi(newValue);
+          if (regaValue.find('"') == std::string::npos) regaValue = '"' + regaValue + '"';
+          else if (regaValue.find('\'') == std::string::npos) regaValue = '\'' + regaValue + '\'';
+          else return BaseLib::Variable::createError(-1, "The value of system variable " + value.first + " contains single and double quotes, which ReGa can't store.");
         }
 
+        script.append("dom.GetObject(" + std::to_string(systemVariable.id) + ").State(" + regaValue + ");\n");
+        newValues.emplace_back(systemVariable.id, newValue);
+      }
+    }
+    if (script.empty()) return std::make_shared<BaseLib::Variable>();
+
+    std::string regaResponse;
+    try {
+      //No retry, because the values might have been set already.
+      regaPost(script, regaResponse, false);
+    }
+    catch (const std::exception &ex) {
+      return BaseLib::Variable::createError(-32300, std::string("Could not set system variables: ") + ex.what());
+    }
+
+    std::lock_guard<std::mutex> systemVariablesGuard(_systemVariablesMutex);
+    for (auto &newValue : newValues) {
+      auto systemVariableIterator = _systemVariables.find(newValue.first);
+      if (systemVariableIterator != _systemVariables.end()) systemVariableIterator->second.value = newValue.second;
+    }
+    return std::make_shared<BaseLib::Variable>();
+  }
+  catch (const std::exception &ex) {
+    _out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+  }
+  return BaseLib::Variable::createError(-32500, "Unknown application error.");
+}
+
+BaseLib::PVariable Ccu::invokeRega(const std::string &methodName, const BaseLib::PArray &parameters) {
+  try {
+    if (methodName == "setValue") {
+      if (parameters->size() < 3) return BaseLib::Variable::createError(-1, "Wrong parameter count.");
+      auto values = std::make_shared<BaseLib::Variable>(BaseLib::VariableType::tStruct);
+      values->structValue->emplace(parameters->at(1)->stringValue, parameters->at(2));
+      return setSystemVariables(values);
+    } else if (methodName == "putParamset") {
+      if (parameters->size() < 3) return BaseLib::Variable::createError(-1, "Wrong parameter count.");
+      if (parameters->at(1)->stringValue != "VALUES") return BaseLib::Variable::createError(-3, "Unknown parameter set.");
+      return setSystemVariables(parameters->at(2));
+    } else if (methodName == "getValue") {
+      if (parameters->size() < 2) return BaseLib::Variable::createError(-1, "Wrong parameter count.");
+      std::lock_guard<std::mutex> systemVariablesGuard(_systemVariablesMutex);
+      auto idIterator = _systemVariableIdsByName.find(parameters->at(1)->stringValue);
+      if (idIterator == _systemVariableIdsByName.end()) return BaseLib::Variable::createError(-5, "Unknown parameter.");
+      return getSystemVariableValue(_systemVariables.at(idIterator->second));
+    } else if (methodName == "getParamset") {
+      auto paramset = std::make_shared<BaseLib::Variable>(BaseLib::VariableType::tStruct);
+      if (parameters->size() < 2 || parameters->at(1)->stringValue != "VALUES") return paramset;
+      std::lock_guard<std::mutex> systemVariablesGuard(_systemVariablesMutex);
+      for (auto &systemVariable : _systemVariables) {
+        paramset->structValue->emplace(systemVariable.second.name, getSystemVariableValue(systemVariable.second));
+      }
+      return paramset;
+    }
+    return BaseLib::Variable::createError(-32601, "Method not supported for system variables.");
+  }
+  catch (const std::exception &ex) {
+    return BaseLib::Variable::createError(-32500, ex.what());
+  }
+}
+
+std::shared_ptr<Ccu::ServiceMessages> Ccu::getNativeServiceMessages(const std::shared_ptr<const ServiceMessages> &previousMessages) {
+  try {
+    std::unordered_map<std::string, int32_t> previousTimes;
+    previousTimes.reserve(previousMessages->size());
+    for (auto &serviceMessage : *previousMessages) {
+      previousTimes.emplace(serviceMessage->serial + "." + serviceMessage->message, serviceMessage->time);
+    }
+
+    auto serviceMessages = std::make_shared<ServiceMessages>();
+    int32_t now = BaseLib::HelperFunctions::getTimeSeconds();
+    for (auto rpcType : {RpcType::bidcos, RpcType::hmip, RpcType::wired, RpcType::hmvirtual}) {
+      if ((rpcType == RpcType::bidcos && !hasBidCos()) || (rpcType == RpcType::hmip && !hasHmip()) || (rpcType == RpcType::wired && !hasWired()) || (rpcType == RpcType::hmvirtual && !hasHmVirtual())) {
+        continue;
+      }
+
+      auto result = invoke(rpcType, "getServiceMessages", std::make_shared<BaseLib::Array>());
+      if (result->errorStruct) {
+        if (_bl->debugLevel >= 5) _out.printDebug("Debug: Error calling \"getServiceMessages\" (" + std::to_string((int32_t)rpcType) + "): " + result->structValue->at("faultString")->stringValue);
+        return std::shared_ptr<ServiceMessages>();
+      }
+
+      //Every element has the format [ADDRESS, PARAMETER, VALUE].
+      for (auto &element : *result->arrayValue) {
+        if (element->arrayValue->size() < 3) continue;
+        auto &value = element->arrayValue->at(2);
+        if (!value->booleanValue && value->integerValue == 0) continue;
+
         auto serviceMessage = std::make_shared<CcuServiceMessage>();
-        serviceMessage->serial = addressIterator->second->stringValue;
-        serviceMessage->value = stateIterator->second->stringValue == "1";
-        serviceMessage->message = messageIterator->second->stringValue;
-        serviceMessage->time = BaseLib::Math::getNumber(timeIterator->second->stringValue);
+        serviceMessage->serial = BaseLib::HelperFunctions::splitFirst(element->arrayValue->at(0)->stringValue, ':').first;
+        serviceMessage->message = element->arrayValue->at(1)->stringValue;
+        serviceMessage->value = true;
+        auto previousTimeIterator = previousTimes.find(serviceMessage->serial + "." + serviceMessage->message);
+        serviceMessage->time = previousTimeIterator == previousTimes.end() ? now : previousTimeIterator->second;
+        serviceMessages->emplace_back(std::move(serviceMessage));
+      }
+    }
+    return serviceMessages;
+  }
+  catch (const std::exception &ex) {
+    _out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+  }
+  return std::shared_ptr<ServiceMessages>();
+}
 
-        _serviceMessages.emplace_back(std::move(serviceMessage));
+std::shared_ptr<Ccu::ServiceMessages> Ccu::parseRegaServiceMessages(const std::string &response) {
+  try {
+    auto serviceMessages = std::make_shared<ServiceMessages>();
+    std::shared_ptr<CcuServiceMessage> serviceMessage;
+    uint32_t fields = 0;
+    RegaJsonParser parser([&](uint32_t depth, const std::string &key, std::string &value) {
+      //Depth 3: {"address", "state", "message", "time"}
+      if (depth != 3 || !serviceMessage) return;
+      if (key == "address") {
+        serviceMessage->serial.swap(value);
+        fields |= 1;
+      } else if (key == "state") {
+        serviceMessage->value = value == "1";
+        fields |= 2;
+      } else if (key == "message") {
+        serviceMessage->message.swap(value);
+        fields |= 4;
+      } else if (key == "time") {
+        serviceMessage->time = BaseLib::Math::getNumber(value);
+        fields |= 8;
       }
+    }, [&](uint32_t depth, const std::string &key) {
+      if (depth != 3) return;
+      serviceMessage = std::make_shared<CcuServiceMessage>();
+      fields = 0;
+    }, [&](uint32_t depth, const std::string &key) {
+      if (depth != 3 || fields != 15) return;
+      serviceMessages->emplace_back(std::move(serviceMessage));
+    });
+
+    if (!parser.feed(response) || !parser.finished()) {
+      _out.printWarning("Warning: Could not parse service messages returned by ReGa.");
+      return std::shared_ptr<ServiceMessages>();
     }
+
+    return serviceMessages;
   }
   catch (const std::exception &ex) {
-    GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+    _out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
   }
+  return std::shared_ptr<ServiceMessages>();
 }
 
 }
@@ -30,6 +30,8 @@
 #ifndef HOMEGEAR_CCU_CCU_H
 #define HOMEGEAR_CCU_CCU_H
 
+#include "../MyPacket.h"
+#include "../EventQueue.h"
 #include <homegear-base/Systems/IPhysicalInterface.h>
 #include <homegear-base/Encoding/XmlrpcDecoder.h>
 #include <homegear-base/Encoding/XmlrpcEncoder.h>
@@ -37,6 +39,8 @@
 #include <homegear-base/Sockets/HttpClient.h>
 #include <c1-net/TcpServer.h>
 
+#include <condition_variable>
+
 namespace MyFamily
 {
 
@@ -48,7 +52,8 @@ public:
         bidcos,
         hmip,
         wired,
-        hmvirtual
+        hmvirtual,
+        rega
     };
 
     struct CcuServiceMessage
@@ -59,6 +64,19 @@ public:
         int32_t time = 0;
     };
 
+    struct SystemVariable
+    {
+        int32_t id = 0;
+        std::string name;
+        int32_t valueType = 0;
+        int32_t valueSubType = 0;
+        std::string valueList;
+        std::string minimum;
+        std::string maximum;
+        std::string unit;
+        std::string value;
+    };
+
     Ccu(std::shared_ptr<BaseLib::Systems::PhysicalInterfaceSettings> settings);
     virtual ~Ccu();
 
@@ -68,28 +86,163 @@ public:
     std::string getPort3() { return _settings->port3; }
     std::string getPort4() { return _settings->port4; }
 
-    bool hasBidCos() { return (bool)_bidcosClient; }
-    bool hasWired() { return (bool)_wiredClient && !_wiredDisabled.load(std::memory_order_acquire); }
-    bool hasHmip() { return (bool)_hmipClient; }
-    bool hasHmVirtual() { return (bool)_hmVirtualClient; }
+    /**
+     * Returns the serial number of the virtual peer holding the CCU's system variables.
+     */
+    std::string getSystemVariablesSerialNumber() { return "SYSVAR" + (_settings->serialNumber.empty() ? _settings->id : _settings->serialNumber); }
+
+    /**
+     * Host and HTTP clients of the CCU. The members are never changed after a snapshot is published, setHost() publishes a new one instead. Requests keep
+     * the snapshot they loaded, so clients replaced in the meantime stay valid until the request finishes.
+     */
+    struct Connection
+    {
+        std::string hostname;
+        std::string ipAddress;
+        std::shared_ptr<BaseLib::HttpClient> bidcosClient;
+        std::shared_ptr<BaseLib::HttpClient> hmipClient;
+        std::shared_ptr<BaseLib::HttpClient> wiredClient;
+        std::shared_ptr<BaseLib::HttpClient> hmVirtualClient;
+        std::shared_ptr<BaseLib::HttpClient> regaClient;
+        std::shared_ptr<BaseLib::HttpClient> regaCheckClient;
+    };
+
+    std::shared_ptr<const Connection> getConnection() { return std::atomic_load(&_connection); }
+
+    /**
+     * Returns the current host of the CCU. Use this instead of getHostname(), which only returns the host the interface was created with.
+     */
+    std::string getHost() { return getConnection()->hostname; }
+
+    bool hasBidCos() { return (bool)getConnection()->bidcosClient; }
+    bool hasWired() { return (bool)getConnection()->wiredClient && !_wiredDisabled.load(std::memory_order_acquire); }
+    bool hasHmip() { return (bool)getConnection()->hmipClient; }
+    bool hasHmVirtual() { return (bool)getConnection()->hmVirtualClient; }
+
+    typedef std::vector<std::shared_ptr<const CcuServiceMessage>> ServiceMessages;
+
+    /**
+     * Returns the service messages of the last poll. The returned snapshot is never modified, a poll replaces it when something changed.
+     */
+    std::shared_ptr<const ServiceMessages> getServiceMessages() { return std::atomic_load(&_serviceMessages); }
+
+    typedef std::unordered_map<std::string, std::unordered_map<int32_t, std::string>> DeviceNames;
+
+    /**
+     * Returns the cached device and channel names of all devices. The cache is loaded on first access and refreshed incrementally afterwards. Concurrent
+     * callers share one load.
+     */
+    std::shared_ptr<const DeviceNames> getNames();
 
-    std::vector<std::shared_ptr<CcuServiceMessage>> getServiceMessages() { std::lock_guard<std::mutex> serviceMessagesGuard(_serviceMessagesMutex); return _serviceMessages; }
-    std::unordered_map<std::string, std::unordered_map<int32_t, std::string>> getNames();
+    /**
+     * Queries the device and channel names of a single device from ReGa and updates the cache.
+     *
+     * @param serialNumber The device's address.
+     * @return Returns the names by channel. The device name has the channel -1.
+     */
+    std::unordered_map<int32_t, std::string> getNames(const std::string &serialNumber);
+
+    /**
+     * Fetches the current values of all device datapoints from ReGa in one script call. The whole response is received first. It is then parsed line by
+     * line and every datapoint is passed to the callback, so no further copy of the values is made.
+     *
+     * @param callback Called for every datapoint with the address ("SERIAL:CHANNEL"), the parameter name, the value as string and the time of the
+     * last change in milliseconds. The time is converted from the CCU's clock to the local clock using the CCU's time at the query, so it can be compared
+     * to local timestamps even when the clocks differ.
+     * @return Returns true when the script was executed successfully.
+     */
+    bool getDatapointValues(const std::function<void(const std::string &address, const std::string &name, const std::string &value, int64_t timestamp)> &callback);
+
+    /**
+     * Executes several ReGa scripts in one "tclrega.exe" request. The output of every script is framed by section markers and split again, so each result
+     * is the same as if the script had been executed on its own. All scripts run in the same ReGa context, so they must not declare the same variables.
+     *
+     * @param scripts The scripts to execute.
+     * @param[out] results The outputs of the scripts in the same order.
+     * @return Returns false if the request failed or the output could not be split.
+     */
+    bool executeRegaScripts(const std::vector<std::string> &scripts, std::vector<std::string> &results);
 
     void startListening();
     void stopListening();
+
+    /**
+     * Points a running interface to a new host. The HTTP clients are replaced, the event server and all peer bindings are kept. Only the callback URLs
+     * are registered again, which also triggers a value resync.
+     *
+     * @return Returns false when the host didn't change.
+     */
+    bool setHost(const std::string &host);
     void sendPacket(std::shared_ptr<BaseLib::Systems::Packet> packet) {};
-    BaseLib::PVariable invoke(RpcType rpcType, std::string methodName, BaseLib::PArray parameters);
 
-    virtual bool isOpen() { return _bidcosClient || _hmipClient || _wiredClient; }
+    enum class InvokePriority : int32_t
+    {
+        normal = 0,
+
+        /**
+         * Radio writes which can wait, e. g. configuration pushes. They are deferred while the duty cycle of the CCU is above "dutyCycleThreshold".
+         */
+        low = 1
+    };
+
+    BaseLib::PVariable invoke(RpcType rpcType, std::string methodName, BaseLib::PArray parameters, InvokePriority priority = InvokePriority::normal);
+
+    struct DutyCycle
+    {
+        /**
+         * The used duty cycle in percent or -1 if unknown.
+         */
+        int32_t dutyCycle = -1;
+
+        /**
+         * The carrier sense level in percent or -1 if unknown.
+         */
+        int32_t carrierSense = -1;
+
+        /**
+         * The time of the last update in milliseconds.
+         */
+        int64_t time = 0;
+    };
+
+    /**
+     * Returns the duty cycle of the BidCoS or HomeMatic IP radio of the CCU. BidCoS values are polled with "listBidcosInterfaces", HomeMatic IP values are
+     * taken from the "DUTY_CYCLE_LEVEL" and "CARRIER_SENSE_LEVEL" events of the access point.
+     */
+    DutyCycle getDutyCycle(RpcType rpcType);
+
+    /**
+     * Returns the number of low priority calls currently deferred because of the duty cycle.
+     */
+    uint32_t getDeferredInvokeCount() { return _deferredInvokes; }
+
+    /**
+     * Removes devices and channels from the device fingerprint, so they are not returned by "listDevices" and the CCU announces them again. Called
+     * for devices reported by "newDevices" that were not added as peers, for deleted peers and for the old address of replaced devices.
+     *
+     * @param addresses Array of device and channel addresses.
+     */
+    void removeKnownDevices(RpcType rpcType, const BaseLib::PVariable &addresses);
+
+    virtual bool isOpen()
+    {
+        auto connection = getConnection();
+        return connection->bidcosClient || connection->hmipClient || connection->wiredClient;
+    }
 private:
     struct CcuClientInfo
     {
         std::shared_ptr<BaseLib::Http> http;
     };
 
+    struct KnownDevice
+    {
+        int32_t version = 0;
+        std::string type;
+    };
+
     BaseLib::Output _out;
-    bool _noHost = true;
+    std::atomic_bool _noHost{true};
     std::atomic_bool _stopped{true};
     int32_t _port = 2001;
     int32_t _port2 = 2010;
@@ -107,11 +260,16 @@ private:
     std::atomic<int64_t> _lastPongWired{0};
     std::atomic<int64_t> _lastPongHmVirtual{0};
     std::shared_ptr<C1Net::TcpServer> _server;
-    std::unique_ptr<BaseLib::HttpClient> _bidcosClient;
-    std::unique_ptr<BaseLib::HttpClient> _hmipClient;
-    std::unique_ptr<BaseLib::HttpClient> _wiredClient;
-    std::unique_ptr<BaseLib::HttpClient> _hmVirtualClient;
-    std::unique_ptr<BaseLib::HttpClient> _httpClient;
+    std::mutex _connectionMutex;
+    std::shared_ptr<const Connection> _connection = std::make_shared<const Connection>();
+    //{{{ ReGa
+    const int64_t _regaReadyTtl = 10000;
+    const int64_t _regaNotReadyTtl = 5000;
+    std::mutex _regaMutex;
+    std::mutex _regaCheckMutex;
+    std::atomic_bool _regaReady{false};
+    std::atomic<int64_t> _regaReadyTime{0};
+    //}}}
     RpcType _connectedRpcType = RpcType::bidcos;
     std::atomic_bool _unreachable{false};
     std::atomic_bool _bidcosDevicesExist{false};
@@ -123,6 +281,7 @@ private:
     std::atomic_bool _wiredDisabled{false};
     std::atomic_bool _hmVirtualNewDevicesCalled{false};
     std::atomic_bool _hmVirtualReInit{false};
+    std::atomic_bool _initCalled{false};
     std::mutex _ccuClientInfoMutex;
     std::map<int32_t, CcuClientInfo> _ccuClientInfo;
     std::unique_ptr<BaseLib::Rpc::XmlrpcEncoder> _xmlrpcEncoder;
@@ -136,10 +295,61 @@ private:
     std::mutex _invokeMutex;
 
     std::string _getServiceMessagesScript = "Write('{ \"serviceMessages\":[');\nboolean isFirst = true;\nstring serviceID;\nforeach (serviceID, dom.GetObject(ID_SERVICES).EnumUsedIDs())\n{\n  object serviceObj = dom.GetObject(serviceID);\n  integer state = serviceObj.AlState();\n  if (state == 1)\n  {\n    string err = serviceObj.Name().StrValueByIndex (\".\", 1);\n    object alObj = serviceObj.AlTriggerDP();\n    object chObj = dom.GetObject(dom.GetObject(alObj).Channel());\n    object devObj = dom.GetObject(chObj.Device());\n    string strDate = serviceObj.Timestamp().Format(\"%s\");\n    if (isFirst) { isFirst = false; } else { WriteLine(\",\"); }\n    Write('{\"address\":\"' # devObj.Address() # '\", \"state\":\"' # state # '\", \"message\":\"' # err # '\", \"time\":\"' # strDate # '\"}');\n  }\n}\nWrite(\"]}\");";
-    std::string _getNamesScript = "string sDevId;\nstring sChnId;\nstring sDPId;\nstring channelId;\nWrite('{');\n    boolean dFirst = true;\n    Write('\"Devices\":[');\n    foreach (sDevId, root.Devices().EnumUsedIDs()) {\n        object oDevice   = dom.GetObject(sDevId);\n        boolean bDevReady = oDevice.ReadyConfig();\n        string sDevInterfaceId = oDevice.Interface();\n        string sDevInterface   = dom.GetObject(sDevInterfaceId).Name();\n        if (bDevReady) {\n            if (dFirst) {\n                dFirst = false;\n            } else {\n                WriteLine(',');\n            }\n            Write('{');\n            Write('\"ID\":\"' # oDevice.ID());\n            Write('\",\"Name\":\"' # oDevice.Name());\n            Write('\",\"TypeName\":\"' # oDevice.TypeName());\n            Write('\",\"HssType\":\"' # oDevice.HssType() # '\",\"Address\":\"' # oDevice.Address() # '\",\"Interface\":\"' # sDevInterface # '\"');\n            Write(',\"Channels\":[');\n            boolean bFirstSecond = true;\n            foreach(channelId, oDevice.Channels()) {      \n                if (bFirstSecond == false) {\n                    Write(',');\n                } else {\n                    bFirstSecond = false;\n                }\n                var channel = dom.GetObject(channelId);\n                Write('{');\n                Write('\"ChannelName\":' # '\"' # channel.Name() # '\"');\n                Write(',\"Address\":' # '\"' # channel.Address() # '\"');\n                Write('}');\n            }\n            Write(']');\n            Write('}');\n        }\n    }\nWrite(']}');";
+    //Placeholders: %ADDRESS% (empty for all devices) and %SINCE% (Unix time, only devices or channels changed since then are returned, 0 for all).
+    std::string _getNamesScript = "string sDevId;\nstring sChnId;\nstring sAddress = \"%ADDRESS%\";\ninteger iSince = %SINCE%;\nboolean dFirst = true;\nWrite('{\"Time\":\"' # system.Date(\"%s\") # '\",\"Devices\":[');\nforeach (sDevId, root.Devices().EnumUsedIDs()) {\n    object oDevice = dom.GetObject(sDevId);\n    boolean bSelected = oDevice.ReadyConfig();\n    if (bSelected && (sAddress != \"\")) {\n        bSelected = (oDevice.Address() == sAddress);\n    }\n    if (bSelected && (iSince > 0)) {\n        bSelected = (oDevice.Timestamp().ToInteger() >= iSince);\n        if (bSelected == false) {\n            foreach (sChnId, oDevice.Channels()) {\n                if (dom.GetObject(sChnId).Timestamp().ToInteger() >= iSince) {\n                    bSelected = true;\n                }\n            }\n        }\n    }\n    if (bSelected) {\n        if (dFirst) {\n            dFirst = false;\n        } else {\n            WriteLine(',');\n        }\n        Write('{\"Address\":\"' # oDevice.Address() # '\",\"Name\":\"' # oDevice.Name() # '\",\"Channels\":[');\n        boolean bFirstChannel = true;\n        foreach (sChnId, oDevice.Channels()) {\n            object oChannel = dom.GetObject(sChnId);\n            if (bFirstChannel) {\n                bFirstChannel = false;\n            } else {\n                Write(',');\n            }\n            Write('{\"ChannelName\":\"' # oChannel.Name() # '\",\"Address\":\"' # oChannel.Address() # '\"}');\n        }\n        Write(']}');\n    }\n}\nWrite(']}');";
+
+    //Placeholder: %SINCE% (Unix time, only system variables changed since then are returned, 0 for all). The first line contains the ReGa time, then
+    //there is one line per system variable: "ID\tTYPE\tSUBTYPE", followed by name, value, value list, minimum, maximum and unit. ReGa strings have no
+    //escape sequences, so these are written as "\tLENGTH:STRING" and may contain any character. The last line is "Count\tCOUNT" with the number of all
+    //system variables, so deletions can be detected.
+    std::string _getSystemVariablesScript = "string sSvId;\nstring sSvField;\ninteger iSvSince = %SINCE%;\ninteger iSvCount = 0;\nWriteLine(system.Date(\"%s\"));\nforeach (sSvId, dom.GetObject(ID_SYSTEM_VARIABLES).EnumUsedIDs()) {\n  object oSv = dom.GetObject(sSvId);\n  iSvCount = iSvCount + 1;\n  if (oSv.Timestamp().ToInteger() >= iSvSince) {\n    Write(sSvId # \"\\t\" # oSv.ValueType() # \"\\t\" # oSv.ValueSubType());\n    sSvField = oSv.Name();\n    Write(\"\\t\" # sSvField.Length() # \":\" # sSvField);\n    sSvField = \"\" # oSv.Value();\n    Write(\"\\t\" # sSvField.Length() # \":\" # sSvField);\n    sSvField = oSv.ValueList();\n    Write(\"\\t\" # sSvField.Length() # \":\" # sSvField);\n    sSvField = \"\" # oSv.ValueMin();\n    Write(\"\\t\" # sSvField.Length() # \":\" # sSvField);\n    sSvField = \"\" # oSv.ValueMax();\n    Write(\"\\t\" # sSvField.Length() # \":\" # sSvField);\n    sSvField = oSv.ValueUnit();\n    WriteLine(\"\\t\" # sSvField.Length() # \":\" # sSvField);\n  }\n}\nWrite(\"Count\\t\" # iSvCount);";
 
-    std::mutex _serviceMessagesMutex;
-    std::vector<std::shared_ptr<CcuServiceMessage>> _serviceMessages;
+    std::string _getDatapointValuesScript = "string sDPId;\nWriteLine(system.Date(\"%s\"));\nforeach (sDPId, dom.GetObject(ID_DATAPOINTS).EnumUsedIDs()) {\n  object oDP = dom.GetObject(sDPId);\n  if (oDP.TypeName() == \"HSSDP\") {\n    WriteLine(oDP.Name() # \"\\t\" # oDP.Value() # \"\\t\" # oDP.Timestamp().ToInteger());\n  }\n}";
+
+    //{{{ Device fingerprint
+    //Stores address, VERSION and TYPE of all devices and channels reported by the CCU. It is returned to the CCU on "listDevices" so that "newDevices" only
+    //contains devices unknown to us.
+    std::mutex _knownDevicesMutex;
+    std::map<RpcType, std::unordered_map<std::string, KnownDevice>> _knownDevices;
+    EventFilter _eventFilter;
+    //}}}
+
+    //{{{ Duty cycle
+    std::mutex _dutyCycleMutex;
+    std::condition_variable _dutyCycleConditionVariable;
+    DutyCycle _dutyCycleBidcos;
+    DutyCycle _dutyCycleHmip;
+    int32_t _dutyCycleThreshold = 80;
+    int64_t _maxDeferral = 5000;
+    std::atomic<uint32_t> _deferredInvokes{0};
+    //}}}
+
+    /**
+     * Dispatches "event" calls by priority class, so alarms and button presses are not delayed by bursts of measurements.
+     */
+    std::unique_ptr<EventQueue> _eventQueue;
+
+    //{{{ System variables
+    std::mutex _systemVariablesMutex;
+    std::map<int32_t, SystemVariable> _systemVariables;
+    std::unordered_map<std::string, int32_t> _systemVariableIdsByName;
+    std::atomic<int64_t> _systemVariablesRegaTime{0};
+    //}}}
+
+    //{{{ Name cache
+    const int64_t _namesRefreshInterval = 60000;
+    std::mutex _namesLoadMutex;
+    std::mutex _namesMutex;
+    std::shared_ptr<const DeviceNames> _names;
+    int64_t _namesLastRefresh = 0;
+    int64_t _namesRegaTime = 0;
+    //}}}
+
+    //{{{ Service messages
+    const int32_t _maxNativeServiceMessageErrors = 3;
+    std::atomic<int32_t> _nativeServiceMessageErrors{0};
+    std::shared_ptr<const ServiceMessages> _serviceMessages = std::make_shared<const ServiceMessages>();
+    //}}}
 
     void log(uint32_t log_level, const std::string &message);
     void newConnection(const C1Net::TcpServer::PTcpClientData &client_data);
@@ -148,9 +358,103 @@ private:
     void processPacket(const C1Net::TcpServer::PTcpClientData &client_data, std::string& methodName, BaseLib::PArray parameters);
     void init();
     void deinit();
+    void requestValueResync(RpcType rpcType);
     void ping();
+
+    /**
+     * Publishes a new connection snapshot for "hostname". The ReGa clients are always recreated. The RPC clients are created for all configured ports when
+     * "createRpcClients" is true, otherwise the ones of the current snapshot are taken over. The caller must hold _connectionMutex.
+     */
+    void publishConnection(const std::string &hostname, bool createRpcClients);
+
+    /**
+     * Checks if ReGa is ready. The result is cached for a few seconds.
+     */
     bool regaReady();
-    void getCcuServiceMessages();
+
+    /**
+     * Executes a ReGa script using the keep-alive connection to "tclrega.exe". Throws on errors.
+     *
+     * @param retry Retry once on connection errors, because the CCU might have closed the keep-alive connection. Must be false for scripts changing
+     * anything, as the error doesn't tell if the script was already sent and executed.
+     */
+    void regaPost(const std::string &script, std::string &response, bool retry = true);
+    void loadKnownDevices();
+    void saveKnownDevices();
+    size_t addKnownDevices(RpcType rpcType, const BaseLib::PVariable &descriptions);
+    BaseLib::PVariable getKnownDevices(RpcType rpcType);
+
+    /**
+     * Applies the event filter to an "event" call.
+     *
+     * @return Returns false when the event is dropped.
+     */
+    bool filterEvent(RpcType rpcType, const BaseLib::PArray &parameters, const PMyPacket &packet);
+
+    /**
+     * Polls the duty cycle of the BidCoS interfaces with "listBidcosInterfaces". The highest value of all interfaces is stored.
+     */
+    void updateBidcosDutyCycle();
+
+    /**
+     * Stores the duty cycle passed in "DUTY_CYCLE_LEVEL" and "CARRIER_SENSE_LEVEL" events of HomeMatic IP.
+     */
+    void dutyCycleEvent(RpcType rpcType, const BaseLib::PArray &parameters);
+
+    /**
+     * Blocks a low priority call until the duty cycle is below "dutyCycleThreshold" again, but not longer than "dutyCycleMaxDeferral". The wait blocks
+     * the calling RPC thread, so it is limited to 10 seconds to stay well below the timeouts of RPC clients.
+     */
+    void waitForDutyCycle(RpcType rpcType, const std::string &methodName);
+
+    /**
+     * Polls the service messages and refreshes stale names. All needed ReGa scripts are executed in one request.
+     */
+    void pollRega();
+    void updateServiceMessages(const std::shared_ptr<const ServiceMessages> &previousMessages, const std::shared_ptr<ServiceMessages> &serviceMessages);
+    std::shared_ptr<ServiceMessages> parseRegaServiceMessages(const std::string &response);
+
+    /**
+     * Gets the service messages with "getServiceMessages" from all enabled daemons.
+     *
+     * @param previousMessages Used to keep the time of messages that already existed, as the daemons don't return it.
+     * @return Returns nullptr when one of the daemons returned an error.
+     */
+    std::shared_ptr<ServiceMessages> getNativeServiceMessages(const std::shared_ptr<const ServiceMessages> &previousMessages);
+    bool parseSystemVariables(const std::string &response, std::vector<SystemVariable> &systemVariables, int64_t &regaTime, int32_t &count);
+
+    /**
+     * Merges changed system variables into the cache and raises a "homegear.systemVariables" packet with the new values. When system variables were
+     * added, removed or their definition changed, the packet also contains the new parameter set description.
+     */
+    void updateSystemVariables(std::vector<SystemVariable> &systemVariables, bool full, int32_t count, int64_t regaTime);
+    BaseLib::PVariable getSystemVariableValue(const SystemVariable &systemVariable);
+    BaseLib::PVariable getSystemVariablesDescription(int32_t &version);
+
+    /**
+     * Writes all given system variables with one ReGa script.
+     *
+     * @param values A struct with the system variable names as keys.
+     */
+    BaseLib::PVariable setSystemVariables(const BaseLib::PVariable &values);
+
+    /**
+     * Handles RPC methods for the system variable peer.
+     */
+    BaseLib::PVariable invokeRega(const std::string &methodName, const BaseLib::PArray &parameters);
+
+    std::string getNamesScript(const std::string &serialNumber, int64_t since);
+    bool parseNames(const std::string &response, DeviceNames &deviceNames, int64_t &regaTime);
+    bool queryNames(const std::string &serialNumber, int64_t since, DeviceNames &deviceNames, int64_t &regaTime);
+
+    /**
+     * Merges changed names into a copy of the given snapshot and publishes it.
+     *
+     * @param names The snapshot the changes are based on or nullptr.
+     * @param since The ReGa time the changes were queried from. 0 for a full load.
+     * @param regaTime The ReGa time of the query.
+     */
+    std::shared_ptr<const DeviceNames> storeNames(const std::shared_ptr<const DeviceNames> &names, int64_t since, DeviceNames &changedNames, int64_t regaTime);
 };
 
 }
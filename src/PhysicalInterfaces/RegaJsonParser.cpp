@@ -0,0 +1,199 @@
+/* Copyright 2013-2019 Homegear GmbH
+ *
+ * Homegear is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Homegear is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Homegear.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ */
+
+#include "RegaJsonParser.h"
+
+namespace MyFamily {
+
+RegaJsonParser::RegaJsonParser(ValueCallback valueCallback, ContainerCallback objectStartCallback, ContainerCallback objectEndCallback) {
+  _valueCallback.swap(valueCallback);
+  _objectStartCallback.swap(objectStartCallback);
+  _objectEndCallback.swap(objectEndCallback);
+  _containers.reserve(_maxDepth);
+  _keys.reserve(_maxDepth);
+}
+
+void RegaJsonParser::reset() {
+  _state = State::value;
+  _isKey = false;
+  _buffer.clear();
+  _unicode.clear();
+  _containers.clear();
+  _keys.clear();
+}
+
+const std::string &RegaJsonParser::parentKey() {
+  static const std::string emptyKey;
+  if (_containers.size() < 2 || _containers.at(_containers.size() - 2) != '{') return emptyKey;
+  return _keys.at(_keys.size() - 2);
+}
+
+bool RegaJsonParser::openContainer(char type) {
+  if (_containers.size() >= _maxDepth) return false;
+  _containers.push_back(type);
+  _keys.emplace_back();
+  if (type == '{') {
+    if (_objectStartCallback) _objectStartCallback(_containers.size(), parentKey());
+    _state = State::key;
+  } else _state = State::value;
+  return true;
+}
+
+bool RegaJsonParser::closeContainer(char type) {
+  if (_containers.empty() || _containers.back() != type) return false;
+  if (type == '{' && _objectEndCallback) _objectEndCallback(_containers.size(), parentKey());
+  _containers.pop_back();
+  _keys.pop_back();
+  _state = _containers.empty() ? State::finished : State::afterValue;
+  return true;
+}
+
+void RegaJsonParser::finishString() {
+  if (_isKey) {
+    _keys.back().swap(_buffer);
+    _buffer.clear();
+    _state = State::colon;
+  } else finishValue();
+}
+
+void RegaJsonParser::finishValue() {
+  if (_valueCallback) {
+    static const std::string emptyKey;
+    bool inObject = !_containers.empty() && _containers.back() == '{';
+    _valueCallback(_containers.size(), inObject ? _keys.back() : emptyKey, _buffer);
+  }
+  _buffer.clear();
+  _state = _containers.empty() ? State::finished : State::afterValue;
+}
+
+void RegaJsonParser::appendUnicode() {
+  uint32_t codePoint = std::stoul(_unicode, nullptr, 16);
+  if (codePoint < 0x80) _buffer.push_back((char)codePoint);
+  else if (codePoint < 0x800) {
+    _buffer.push_back((char)(0xC0 | (codePoint >> 6)));
+    _buffer.push_back((char)(0x80 | (codePoint & 0x3F)));
+  } else {
+    _buffer.push_back((char)(0xE0 | (codePoint >> 12)));
+    _buffer.push_back((char)(0x80 | ((codePoint >> 6) & 0x3F)));
+    _buffer.push_back((char)(0x80 | (codePoint & 0x3F)));
+  }
+  _unicode.clear();
+}
+
+bool RegaJsonParser::feed(const char *data, size_t size) {
+  for (size_t i = 0; i < size; i++) {
+    char c = data[i];
+    switch (_state) {
+      case State::finished:
+        return true;
+      case State::error:
+        return false;
+      case State::value:
+        if (isWhitespace(c)) break;
+        if (c == '{' || c == '[') {
+          if (!openContainer(c)) _state = State::error;
+        } else if (c == ']') {
+          //Empty array
+          if (!closeContainer('[')) _state = State::error;
+        } else if (c == '"') {
+          _isKey = false;
+          _state = State::string;
+        } else if (c == '-' || (c >= '0' && c <= '9') || c == 't' || c == 'f' || c == 'n') {
+          _buffer.push_back(c);
+          _state = State::literal;
+        } else _state = State::error;
+        break;
+      case State::key:
+        if (isWhitespace(c)) break;
+        if (c == '"') {
+          _isKey = true;
+          _state = State::string;
+        } else if (c == '}') {
+          if (!closeContainer('{')) _state = State::error;
+        } else _state = State::error;
+        break;
+      case State::colon:
+        if (isWhitespace(c)) break;
+        _state = c == ':' ? State::value : State::error;
+        break;
+      case State::afterValue:
+        if (isWhitespace(c)) break;
+        if (c == ',') _state = _containers.back() == '{' ? State::key : State::value;
+        else if (c == '}' || c == ']') {
+          if (!closeContainer(c == '}' ? '{' : '[')) _state = State::error;
+        } else _state = State::error;
+        break;
+      case State::string:
+        if (c == '\\') _state = State::escape;
+        else if (c == '"') finishString();
+        else _buffer.push_back(c);
+        break;
+      case State::escape:
+        _state = State::string;
+        switch (c) {
+          case 'n': _buffer.push_back('\n');
+            break;
+          case 'r': _buffer.push_back('\r');
+            break;
+          case 't': _buffer.push_back('\t');
+            break;
+          case 'b': _buffer.push_back('\b');
+            break;
+          case 'f': _buffer.push_back('\f');
+            break;
+          case 'u': _state = State::unicode;
+            break;
+          default: _buffer.push_back(c);
+        }
+        break;
+      case State::unicode:
+        if (!isxdigit((unsigned char)c)) {
+          _state = State::error;
+          break;
+        }
+        _unicode.push_back(c);
+        if (_unicode.size() == 4) {
+          appendUnicode();
+          _state = State::string;
+        }
+        break;
+      case State::literal:
+        if (isalnum((unsigned char)c) || c == '.' || c == '+' || c == '-') _buffer.push_back(c);
+        else {
+          finishValue();
+          //Process the terminating character again in the new state.
+          i--;
+        }
+        break;
+    }
+  }
+  return _state != State::error;
+}
+
+}
@@ -0,0 +1,120 @@
+/* Copyright 2013-2019 Homegear GmbH
+ *
+ * Homegear is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Homegear is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Homegear.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ */
+
+#ifndef HOMEGEAR_CCU_REGAJSONPARSER_H
+#define HOMEGEAR_CCU_REGAJSONPARSER_H
+
+#include <cctype>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace MyFamily
+{
+
+/**
+ * Incremental (SAX-style) JSON parser for the output of ReGa scripts. Instead of building a variable tree, it reports every scalar value together with its
+ * key and nesting depth. Data can be fed in arbitrary chunks. Everything after the top level value (like the XML trailer appended by "tclrega.exe") is
+ * ignored.
+ *
+ * String values are passed through as raw bytes, so no character set conversion is done by the parser.
+ */
+class RegaJsonParser
+{
+public:
+    /**
+     * @param depth The nesting depth of the object or array. The top level object has the depth 1.
+     * @param key The key of the object or array in the parent object. Empty if the parent is an array.
+     */
+    typedef std::function<void(uint32_t depth, const std::string &key)> ContainerCallback;
+
+    /**
+     * @param depth The nesting depth of the object or array containing the value.
+     * @param key The key of the value. Empty if the value is an array element.
+     * @param value The unescaped value. Numbers and literals are passed as is.
+     */
+    typedef std::function<void(uint32_t depth, const std::string &key, std::string &value)> ValueCallback;
+
+    RegaJsonParser(ValueCallback valueCallback, ContainerCallback objectStartCallback = nullptr, ContainerCallback objectEndCallback = nullptr);
+    virtual ~RegaJsonParser() = default;
+
+    /**
+     * Parses the next chunk of data.
+     *
+     * @return Returns false on syntax errors.
+     */
+    bool feed(const char *data, size_t size);
+    bool feed(const std::string &data) { return feed(data.data(), data.size()); }
+
+    /**
+     * Returns true when the top level value was parsed completely.
+     */
+    bool finished() { return _state == State::finished; }
+
+    void reset();
+private:
+    enum class State
+    {
+        value,
+        key,
+        colon,
+        afterValue,
+        string,
+        escape,
+        unicode,
+        literal,
+        finished,
+        error
+    };
+
+    const size_t _maxDepth = 32;
+
+    ValueCallback _valueCallback;
+    ContainerCallback _objectStartCallback;
+    ContainerCallback _objectEndCallback;
+
+    State _state = State::value;
+    bool _isKey = false;
+    std::string _buffer;
+    std::string _unicode;
+    std::vector<char> _containers;
+    std::vector<std::string> _keys;
+
+    static bool isWhitespace(char c) { return c == ' ' || c == '\n' || c == '\r' || c == '\t'; }
+    const std::string &parentKey();
+    bool openContainer(char type);
+    bool closeContainer(char type);
+    void finishString();
+    void finishValue();
+    void appendUnicode();
+};
+
+}
+
+#endif